@@ -0,0 +1,148 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+// 区域（bump）分配器：从大块内存里顺序切分，不支持单独释放，用完后arena_release一次全部归还。
+// 适合"一次加载/一次查询内分配、结束时整体释放"的数据：表的列、哈希节点、结果集等。
+// 知道大概用量时先arena_reserve一次预留，后续分配都落在同一块里。
+// 单个Arena不是线程安全的，并发加载时每个任务各用一个。
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGN 8                      // arena_alloc按8字节对齐
+#define ARENA_DEFAULT_BLOCK (64 << 10)     // 未预留时每块64KB
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *prev;  // 上一块（块按分配顺序倒着串起来）
+    size_t used;
+    size_t capacity;
+    char data[];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;   // 当前分配所在的块
+    void *last;         // 最近一次分配的起点，arena_grow据此原地扩展
+    size_t reserved;    // 已向系统申请的总字节数
+} Arena;
+
+// 位置标记：arena_rewind回到标记处，之后分配的内存全部作废
+typedef struct {
+    ArenaBlock *block;
+    size_t used;
+} ArenaMark;
+
+static inline void arena_init(Arena *arena) {
+    memset(arena, 0, sizeof(*arena));
+}
+
+static inline size_t arena_align(size_t offset, size_t align) {
+    return (offset + align - 1) & ~(align - 1);
+}
+
+static inline int arena_new_block(Arena *arena, size_t capacity) {
+    if (capacity < ARENA_DEFAULT_BLOCK) capacity = ARENA_DEFAULT_BLOCK;
+    ArenaBlock *block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + capacity);
+    if (!block) return -1;
+    block->prev = arena->head;
+    block->used = 0;
+    block->capacity = capacity;
+    arena->head = block;
+    arena->last = NULL;
+    arena->reserved += capacity;
+    return 0;
+}
+
+// 保证当前块至少还有bytes字节可用（按文件大小等估算一次性预留），失败返回-1
+static inline int arena_reserve(Arena *arena, size_t bytes) {
+    ArenaBlock *block = arena->head;
+    if (block && block->capacity - arena_align(block->used, ARENA_ALIGN) >= bytes + ARENA_ALIGN) return 0;
+    return arena_new_block(arena, bytes + ARENA_ALIGN);
+}
+
+// 按align对齐分配size字节，当前块放不下时换一块（新块至少是上一块的两倍）
+static inline void* arena_alloc_aligned(Arena *arena, size_t size, size_t align) {
+    ArenaBlock *block = arena->head;
+    size_t start = block ? arena_align(block->used, align) : 0;
+    if (!block || start + size > block->capacity) {
+        size_t capacity = block ? block->capacity * 2 : 0;
+        if (capacity < size) capacity = size;
+        if (arena_new_block(arena, capacity) != 0) return NULL;
+        block = arena->head;
+        start = 0;
+    }
+    void *p = block->data + start;
+    block->used = start + size;
+    arena->last = p;
+    return p;
+}
+
+// 分配size字节（按8字节对齐，内容未初始化），失败返回NULL
+static inline void* arena_alloc(Arena *arena, size_t size) {
+    return arena_alloc_aligned(arena, size, ARENA_ALIGN);
+}
+
+static inline void* arena_calloc(Arena *arena, size_t count, size_t size) {
+    void *p = arena_alloc(arena, count * size);
+    if (p) memset(p, 0, count * size);
+    return p;
+}
+
+// 把ptr（old_size字节）扩到new_size：ptr是最近一次分配且块内放得下时原地扩展，
+// 否则另分配一段并复制（旧的那段随arena一起释放）。失败返回NULL，原数据不变
+static inline void* arena_grow(Arena *arena, void *ptr, size_t old_size, size_t new_size) {
+    if (!ptr) return arena_alloc(arena, new_size);
+    ArenaBlock *block = arena->head;
+    if (ptr == arena->last) {
+        size_t start = (size_t)((char*)ptr - block->data);
+        if (start + new_size <= block->capacity) {
+            block->used = start + new_size;
+            return ptr;
+        }
+    }
+    void *p = arena_alloc(arena, new_size);
+    if (p) memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+    return p;
+}
+
+// 复制一段字节（不对齐、不补'\0'），用于紧凑存放字符串正文
+static inline char* arena_copy_bytes(Arena *arena, const char *data, size_t len) {
+    char *p = (char*)arena_alloc_aligned(arena, len, 1);
+    if (p) memcpy(p, data, len);
+    return p;
+}
+
+// 复制一段字符串并补'\0'
+static inline char* arena_strndup(Arena *arena, const char *str, size_t len) {
+    char *p = (char*)arena_alloc_aligned(arena, len + 1, 1);
+    if (p) {
+        memcpy(p, str, len);
+        p[len] = '\0';
+    }
+    return p;
+}
+
+static inline ArenaMark arena_mark(const Arena *arena) {
+    ArenaMark mark = { arena->head, arena->head ? arena->head->used : 0 };
+    return mark;
+}
+
+// 回到mark处：mark之后新申请的块归还系统，mark所在块的用量恢复
+static inline void arena_rewind(Arena *arena, ArenaMark mark) {
+    while (arena->head && arena->head != mark.block) {
+        ArenaBlock *prev = arena->head->prev;
+        arena->reserved -= arena->head->capacity;
+        free(arena->head);
+        arena->head = prev;
+    }
+    if (arena->head) arena->head->used = mark.used;
+    arena->last = NULL;
+}
+
+// 一次释放全部内存，arena可以继续使用
+static inline void arena_release(Arena *arena) {
+    ArenaMark empty = { NULL, 0 };
+    arena_rewind(arena, empty);
+    arena->reserved = 0;
+}
+
+#endif
@@ -0,0 +1,443 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// 基准测试框架：各程序共用的计时、多次运行和统计。
+// 计时用CLOCK_MONOTONIC墙上时间（clock()是进程CPU时间：等待I/O不算，多线程时各线程的时间加在一起）。
+// 每次运行分成若干命名阶段（load / build / probe / sort / output / free 等），bench_phase切换阶段，
+// 同一次运行中回到已有阶段时时间累加（例如加载和建索引交替进行）。
+// 先做warmup次预热（不计入统计），再测量runs次，最后对每个阶段和总耗时统计
+// 最小值、中位数、平均值、p95、p99、最大值和标准差，打印出来，并可写成CSV（追加，便于跨版本对比）和JSON。
+//
+// 缓存模式（--cache，统计和CSV/JSON中分别标明，不同模式的结果互不混合）：
+//   warm  ：默认。每次运行前把输入文件完整读一遍，保证都在页缓存里
+//   cold  ：每次运行前把输入文件清出页缓存（posix_fadvise DONTNEED），读取真正走磁盘
+//   direct：同cold，且CsvMap.h用O_DIRECT读入，读取期间也不经过页缓存
+//   mem   ：CsvMap.h第一次打开文件时整份读入内存并保留，之后的运行直接借用，只剩计算的开销
+// 输入文件由bench_input登记，此外CsvMap.h打开过的文件（如列存快照）也都算输入，
+// 它们在第一次打开之后才能被清出、预读或常驻：cold/direct/mem模式最好保留至少一次预热。
+// 比较warm和cold（或direct）的各阶段耗时，就能看出哪些开销是I/O，哪些是计算；mem再去掉了读取本身。
+// 逐行用stdio读取的程序（CompareU/CompareRS/Update）不经过CsvMap.h，direct和mem对它们分别等同于cold和warm。
+//
+// --perf 时每个阶段还用PerfCounters.h统计周期数、指令数、L1/LLC缺失、分支预测失败和缺页，
+// 统计表之后按阶段打印每次运行的平均值（JSON中也有）。计数器在第一次运行前打开，线程池在那之后才创建，
+// 池中线程的计数也都算进去。计数器不可用时只打印原因，计时照常。
+//   Bench bench;
+//   bench_init(&bench, "RetrievalSingle", 10, 1);
+//   bench_input(&bench, "inventory_parts.csv");
+//   if (bench_parse_args(&bench, &argc, argv) != 0) return 1;   // --runs N --warmup N --csv 文件 --json 文件 --cache 模式 --perf
+//   while (bench_next_run(&bench)) {
+//       bench_phase(&bench, "load");   ...
+//       bench_phase(&bench, "output"); ...
+//       bench_run_end(&bench, ok);
+//   }
+//   bench_report(&bench);
+//   bench_free(&bench);
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "CsvMap.h"
+#include "PerfCounters.h"
+
+#define BENCH_MAX_PHASES 8
+#define BENCH_MAX_INPUTS 32
+#define BENCH_MAX_RUNS 100000
+#define BENCH_TOTAL BENCH_MAX_PHASES  // 样本中总耗时所在的列
+
+typedef enum {
+    BENCH_WARM = 0,
+    BENCH_COLD,
+    BENCH_DIRECT,
+    BENCH_RESIDENT
+} BenchCache;
+
+static const char *const bench_cache_names[] = { "warm", "cold", "direct", "mem" };
+
+typedef struct {
+    const char *name;                     // 程序名，写进CSV/JSON
+    BenchCache cache;                     // 缓存模式
+    const char *inputs[BENCH_MAX_INPUTS]; // bench_input登记的输入文件
+    int input_count;
+    int runs;                             // 测量次数
+    int warmup;                           // 预热次数
+    const char *csv_path;                 // 非NULL时把统计追加到这个CSV文件
+    const char *json_path;                // 非NULL时把统计和样本写成JSON
+    const char *phases[BENCH_MAX_PHASES]; // 按第一次出现的顺序
+    int phase_count;
+    double *samples;                      // 每次成功的测量占BENCH_MAX_PHASES + 1列（秒）
+    int recorded;                         // 已记录的成功测量次数
+    int failed;                           // 失败的测量次数
+    int run;                              // 当前运行的序号：预热时为负数，测量从0开始
+    int started;
+    double run_start;
+    double phase_start;
+    int phase;                            // 当前阶段下标，-1表示不在任何阶段
+    double current[BENCH_MAX_PHASES + 1]; // 本次运行各阶段的耗时
+    int perf_enabled;                     // --perf
+    PerfCounters perf;                    // 可用计数器个数为0时不读
+    PerfSample perf_mark;                 // 上次切换阶段时的读数
+    PerfSample perf_run_mark;             // 本次运行开始时的读数
+    double perf_current[BENCH_MAX_PHASES + 1][PERF_COUNTER_COUNT];  // 本次运行各阶段的计数
+    double perf_sum[BENCH_MAX_PHASES + 1][PERF_COUNTER_COUNT];      // 成功测量的计数之和
+} Bench;
+
+typedef struct {
+    double min, median, mean, p95, p99, max, stddev;
+} BenchStats;
+
+// 单调时钟（秒）
+static inline double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static inline void bench_init(Bench *bench, const char *name, int runs, int warmup) {
+    memset(bench, 0, sizeof(*bench));
+    bench->name = name;
+    bench->runs = runs;
+    bench->warmup = warmup;
+    bench->phase = -1;
+    bench->perf.available = 0;
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) bench->perf.fd[i] = -1;
+}
+
+// 登记一个输入文件，缓存模式据此在每次运行前清出或预读
+static inline void bench_input(Bench *bench, const char *path) {
+    if (bench->input_count < BENCH_MAX_INPUTS) bench->inputs[bench->input_count++] = path;
+}
+
+// 取出并删除命令行中的 --runs N、--warmup N、--csv 文件、--json 文件、--cache 模式、--perf，其余参数按原顺序保留。
+// 参数不合法时打印用法并返回-1
+static inline int bench_parse_args(Bench *bench, int *argc, char **argv) {
+    int kept = 1;
+    const char *cache = NULL;
+    for (int i = 1; i < *argc; i++) {
+        const char *opt = argv[i];
+        int has_value = i + 1 < *argc;
+        if (strcmp(opt, "--runs") == 0 && has_value) {
+            bench->runs = atoi(argv[++i]);
+        } else if (strcmp(opt, "--warmup") == 0 && has_value) {
+            bench->warmup = atoi(argv[++i]);
+        } else if (strcmp(opt, "--csv") == 0 && has_value) {
+            bench->csv_path = argv[++i];
+        } else if (strcmp(opt, "--json") == 0 && has_value) {
+            bench->json_path = argv[++i];
+        } else if (strcmp(opt, "--cache") == 0 && has_value) {
+            cache = argv[++i];
+        } else if (strcmp(opt, "--perf") == 0) {
+            bench->perf_enabled = 1;
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    *argc = kept;
+    argv[kept] = NULL;
+    if (cache) {
+        int m = 0;
+        while (m <= BENCH_RESIDENT && strcmp(cache, bench_cache_names[m]) != 0) m++;
+        if (m > BENCH_RESIDENT) {
+            printf("基准参数错误：--cache 须为 warm、cold、direct 或 mem\n");
+            return -1;
+        }
+        bench->cache = (BenchCache)m;
+    }
+    if (bench->runs < 1 || bench->runs > BENCH_MAX_RUNS || bench->warmup < 0) {
+        printf("基准参数错误：--runs 须在1到%d之间，--warmup 不能为负数\n", BENCH_MAX_RUNS);
+        return -1;
+    }
+    return 0;
+}
+
+// 运行开始前按缓存模式准备输入文件（不计时）
+static inline void bench_prepare_cache(Bench *bench) {
+    int (*fn)(const char *path) = NULL;
+    if (bench->cache == BENCH_COLD || bench->cache == BENCH_DIRECT) {
+        fn = csv_evict;
+    } else if (bench->cache == BENCH_WARM) {
+        fn = csv_prefetch;
+    } else {
+        return;  // 常驻模式由CsvMap.h在第一次打开时读入
+    }
+    for (int i = 0; i < bench->input_count; i++) fn(bench->inputs[i]);
+    csv_for_each_tracked(fn);
+}
+
+// 开始下一次运行（先预热再测量），全部完成后返回0
+static inline int bench_next_run(Bench *bench) {
+    if (!bench->started) {
+        bench->started = 1;
+        bench->run = -bench->warmup;
+        csv_read_mode = bench->cache == BENCH_DIRECT ? CSV_READ_DIRECT :
+                        bench->cache == BENCH_RESIDENT ? CSV_READ_RESIDENT : CSV_READ_MMAP;
+        csv_tracking = bench->cache != BENCH_WARM;  // 热缓存只需预读bench->inputs，不必登记
+        bench->samples = (double*)malloc((size_t)bench->runs * (BENCH_MAX_PHASES + 1) * sizeof(double));
+        if (!bench->samples) {
+            printf("基准样本内存分配失败\n");
+            return 0;
+        }
+        if (bench->perf_enabled && perf_open(&bench->perf) < 0) {
+            printf("性能计数器不可用（%s），只统计耗时\n", strerror(bench->perf.error));
+        }
+    } else {
+        bench->run++;
+    }
+    if (bench->run >= bench->runs) return 0;
+    bench_prepare_cache(bench);
+    memset(bench->current, 0, sizeof(bench->current));
+    memset(bench->perf_current, 0, sizeof(bench->perf_current));
+    bench->phase = -1;
+    if (bench->perf.available > 0) {
+        perf_read(&bench->perf, &bench->perf_run_mark);
+        bench->perf_mark = bench->perf_run_mark;
+    }
+    bench->run_start = bench->phase_start = bench_now();
+    return 1;
+}
+
+static inline int bench_is_warmup(const Bench *bench) {
+    return bench->run < 0;
+}
+
+// 把上次切换以来的计数记到column列（负数表示不在任何阶段，不记），轮流计数换算后的读数可能略有回退，差值按0计
+static inline void bench_perf_take(Bench *bench, int column) {
+    PerfSample sample;
+    perf_read(&bench->perf, &sample);
+    for (int i = 0; column >= 0 && i < PERF_COUNTER_COUNT; i++) {
+        if (sample.value[i] > bench->perf_mark.value[i]) {
+            bench->perf_current[column][i] += (double)(sample.value[i] - bench->perf_mark.value[i]);
+        }
+    }
+    bench->perf_mark = sample;
+}
+
+static inline void bench_close_phase(Bench *bench, double now) {
+    if (bench->phase >= 0) bench->current[bench->phase] += now - bench->phase_start;
+    if (bench->perf.available > 0) bench_perf_take(bench, bench->phase);
+    bench->phase = -1;
+}
+
+// 结束当前阶段，开始名为phase的阶段（名字按指针或内容匹配）；bench为NULL时什么也不做
+static inline void bench_phase(Bench *bench, const char *phase) {
+    if (!bench) return;
+    double now = bench_now();
+    bench_close_phase(bench, now);
+    int i = 0;
+    while (i < bench->phase_count && bench->phases[i] != phase && strcmp(bench->phases[i], phase) != 0) i++;
+    if (i == bench->phase_count) {
+        if (i == BENCH_MAX_PHASES) return;  // 阶段太多，超出的不计时
+        bench->phases[bench->phase_count++] = phase;
+    }
+    bench->phase = i;
+    bench->phase_start = now;
+}
+
+// 本次运行中某个阶段到目前为止的耗时（秒，包括正在进行的部分），没有这个阶段返回0
+static inline double bench_phase_time(const Bench *bench, const char *phase) {
+    for (int i = 0; i < bench->phase_count; i++) {
+        if (strcmp(bench->phases[i], phase) != 0) continue;
+        return bench->current[i] + (i == bench->phase ? bench_now() - bench->phase_start : 0.0);
+    }
+    return 0.0;
+}
+
+// 结束本次运行，ok为0表示失败（不计入统计）。返回本次总耗时（秒）
+static inline double bench_run_end(Bench *bench, int ok) {
+    double now = bench_now();
+    bench_close_phase(bench, now);
+    bench->current[BENCH_TOTAL] = now - bench->run_start;
+    for (int i = 0; bench->perf.available > 0 && i < PERF_COUNTER_COUNT; i++) {
+        const PerfSample *start = &bench->perf_run_mark, *end = &bench->perf_mark;
+        bench->perf_current[BENCH_TOTAL][i] =
+            end->value[i] > start->value[i] ? (double)(end->value[i] - start->value[i]) : 0.0;
+    }
+    if (bench->run >= 0 && bench->samples) {
+        if (ok) {
+            memcpy(bench->samples + (size_t)bench->recorded * (BENCH_MAX_PHASES + 1), bench->current,
+                   sizeof(bench->current));
+            for (int c = 0; c <= BENCH_MAX_PHASES; c++) {
+                for (int i = 0; i < PERF_COUNTER_COUNT; i++) bench->perf_sum[c][i] += bench->perf_current[c][i];
+            }
+            bench->recorded++;
+        } else {
+            bench->failed++;
+        }
+    }
+    return bench->current[BENCH_TOTAL];
+}
+
+// 平方根（牛顿迭代），免得各程序为一个sqrt链接-lm
+static inline double bench_sqrt(double x) {
+    if (x <= 0) return 0.0;
+    double r = x > 1 ? x : 1.0;
+    for (int i = 0; i < 200; i++) {
+        double next = (r + x / r) / 2;
+        if (next >= r) break;
+        r = next;
+    }
+    return r;
+}
+
+static inline int bench_compare_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// 第column列（阶段下标或BENCH_TOTAL）的统计；values需要recorded个double的临时空间，返回后是排好序的样本
+static inline void bench_column_stats(const Bench *bench, int column, double *values, BenchStats *stats) {
+    int n = bench->recorded;
+    memset(stats, 0, sizeof(*stats));
+    if (n == 0) return;
+    double sum = 0.0;
+    for (int r = 0; r < n; r++) {
+        values[r] = bench->samples[(size_t)r * (BENCH_MAX_PHASES + 1) + column];
+        sum += values[r];
+    }
+    qsort(values, n, sizeof(double), bench_compare_double);
+    stats->min = values[0];
+    stats->max = values[n - 1];
+    stats->mean = sum / n;
+    stats->median = n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+    // 百分位取最近秩：不小于p%样本的最小值
+    stats->p95 = values[(95 * n + 99) / 100 - 1];
+    stats->p99 = values[(99 * n + 99) / 100 - 1];
+    double var = 0.0;
+    for (int r = 0; r < n; r++) var += (values[r] - stats->mean) * (values[r] - stats->mean);
+    stats->stddev = n > 1 ? bench_sqrt(var / (n - 1)) : 0.0;
+}
+
+static inline const char* bench_column_name(const Bench *bench, int column) {
+    return column == BENCH_TOTAL ? "total" : bench->phases[column];
+}
+
+static inline void bench_write_csv(const Bench *bench, double *values, long timestamp) {
+    FILE *out = fopen(bench->csv_path, "a");
+    if (!out) {
+        perror("无法写入基准CSV文件");
+        return;
+    }
+    fseek(out, 0, SEEK_END);
+    if (ftell(out) == 0) {
+        fprintf(out, "timestamp,name,cache,phase,runs,warmup,failed,"
+                     "min_ms,median_ms,mean_ms,p95_ms,p99_ms,max_ms,stddev_ms\n");
+    }
+    for (int c = 0; c <= bench->phase_count; c++) {
+        int column = c == bench->phase_count ? BENCH_TOTAL : c;
+        BenchStats s;
+        bench_column_stats(bench, column, values, &s);
+        fprintf(out, "%ld,%s,%s,%s,%d,%d,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+                timestamp, bench->name, bench_cache_names[bench->cache], bench_column_name(bench, column), bench->recorded, bench->warmup,
+                bench->failed, s.min * 1e3, s.median * 1e3, s.mean * 1e3, s.p95 * 1e3, s.p99 * 1e3,
+                s.max * 1e3, s.stddev * 1e3);
+    }
+    if (fclose(out) != 0) perror("无法写入基准CSV文件");
+}
+
+// 名字都是程序里的常量（ASCII标识符），不需要转义
+static inline void bench_write_json(const Bench *bench, double *values, long timestamp) {
+    FILE *out = fopen(bench->json_path, "w");
+    if (!out) {
+        perror("无法写入基准JSON文件");
+        return;
+    }
+    fprintf(out, "{\n  \"name\": \"%s\",\n  \"cache\": \"%s\",\n  \"timestamp\": %ld,\n  \"runs\": %d,\n"
+                 "  \"warmup\": %d,\n  \"failed\": %d,\n  \"phases\": [\n",
+            bench->name, bench_cache_names[bench->cache], timestamp, bench->recorded, bench->warmup, bench->failed);
+    for (int c = 0; c <= bench->phase_count; c++) {
+        int column = c == bench->phase_count ? BENCH_TOTAL : c;
+        BenchStats s;
+        bench_column_stats(bench, column, values, &s);
+        fprintf(out, "    {\"phase\": \"%s\", \"min_ms\": %.4f, \"median_ms\": %.4f, \"mean_ms\": %.4f, "
+                     "\"p95_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f, \"stddev_ms\": %.4f, \"samples_ms\": [",
+                bench_column_name(bench, column), s.min * 1e3, s.median * 1e3, s.mean * 1e3,
+                s.p95 * 1e3, s.p99 * 1e3, s.max * 1e3, s.stddev * 1e3);
+        // 样本按运行顺序输出
+        for (int r = 0; r < bench->recorded; r++) {
+            fprintf(out, "%s%.4f", r > 0 ? ", " : "",
+                    bench->samples[(size_t)r * (BENCH_MAX_PHASES + 1) + column] * 1e3);
+        }
+        fprintf(out, "]");
+        if (bench->perf.available > 0) {
+            // 每次运行的平均计数，不可用的计数器为null
+            fprintf(out, ", \"counters\": {");
+            for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+                fprintf(out, "%s\"%s\": ", i > 0 ? ", " : "", perf_counter_names[i]);
+                if (perf_has(&bench->perf, (PerfCounterId)i)) {
+                    fprintf(out, "%.0f", bench->perf_sum[column][i] / bench->recorded);
+                } else {
+                    fprintf(out, "null");
+                }
+            }
+            fprintf(out, "}");
+        }
+        fprintf(out, "}%s\n", c < bench->phase_count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    if (fclose(out) != 0) perror("无法写入基准JSON文件");
+}
+
+// 打印各阶段每次运行的平均计数（不可用的计数器显示"-"）和每周期指令数
+static inline void bench_report_perf(const Bench *bench) {
+    static const char *const headers[PERF_COUNTER_COUNT] = {
+        "cycles", "instructions", "L1D-miss", "LLC-miss", "br-miss", "faults"
+    };
+    printf("\n%-8s", "phase");
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) printf(" %14s", headers[i]);
+    printf(" %6s  （每次运行平均）\n", "IPC");
+    for (int c = 0; c <= bench->phase_count; c++) {
+        int column = c == bench->phase_count ? BENCH_TOTAL : c;
+        const double *sum = bench->perf_sum[column];
+        printf("%-8s", bench_column_name(bench, column));
+        for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+            if (perf_has(&bench->perf, (PerfCounterId)i)) {
+                printf(" %14.0f", sum[i] / bench->recorded);
+            } else {
+                printf(" %14s", "-");
+            }
+        }
+        if (perf_has(&bench->perf, PERF_CYCLES) && perf_has(&bench->perf, PERF_INSTRUCTIONS) && sum[PERF_CYCLES] > 0) {
+            printf(" %6.2f\n", sum[PERF_INSTRUCTIONS] / sum[PERF_CYCLES]);
+        } else {
+            printf(" %6s\n", "-");
+        }
+    }
+}
+
+// 打印各阶段和总耗时的统计，并按需写出CSV/JSON
+static inline void bench_report(const Bench *bench) {
+    printf("\n===== 基准统计：%s | 缓存模式 %s | 预热 %d 次 | 测量成功 %d 次 | 失败 %d 次 =====\n",
+           bench->name, bench_cache_names[bench->cache], bench->warmup, bench->recorded, bench->failed);
+    if (bench->recorded == 0) {
+        printf("没有成功的测量，无法统计\n");
+        return;
+    }
+    double *values = (double*)malloc(bench->recorded * sizeof(double));
+    if (!values) {
+        printf("基准统计内存分配失败\n");
+        return;
+    }
+    printf("%-8s %10s %10s %10s %10s %10s %10s %10s  （毫秒）\n",
+           "phase", "min", "median", "mean", "p95", "p99", "max", "stddev");
+    for (int c = 0; c <= bench->phase_count; c++) {
+        int column = c == bench->phase_count ? BENCH_TOTAL : c;
+        BenchStats s;
+        bench_column_stats(bench, column, values, &s);
+        printf("%-8s %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", bench_column_name(bench, column),
+               s.min * 1e3, s.median * 1e3, s.mean * 1e3, s.p95 * 1e3, s.p99 * 1e3, s.max * 1e3, s.stddev * 1e3);
+    }
+    if (bench->perf.available > 0) bench_report_perf(bench);
+    long timestamp = (long)time(NULL);
+    if (bench->csv_path) bench_write_csv(bench, values, timestamp);
+    if (bench->json_path) bench_write_json(bench, values, timestamp);
+    free(values);
+}
+
+static inline void bench_free(Bench *bench) {
+    free(bench->samples);
+    bench->samples = NULL;
+    if (bench->cache == BENCH_RESIDENT) csv_release_resident();
+    perf_close(&bench->perf);
+}
+
+#endif
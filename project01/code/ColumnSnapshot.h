@@ -0,0 +1,362 @@
+#ifndef COLUMN_SNAPSHOT_H
+#define COLUMN_SNAPSHOT_H
+
+// 表的二进制列存快照：第一次读某个CSV时按列转换后写到"<csv路径>.snap"，
+// 记录CSV的大小和修改时间；以后只要CSV没变，就直接映射快照，不再解析文本。
+//
+// 文件布局（所有段按8字节对齐）：
+//   SnapHeader
+//   SnapColumnDesc[column_count]
+//   各列数据：整数列为int32_t[row_count]；
+//            字符串列为uint32_t编码[row_count] + 字典偏移uint32_t[dict_count+1] + 字典正文
+// 字符串列保存CSV字段的原始文本（含引号），去引号等处理仍由各读取函数负责。
+
+#include <stdint.h>
+#include <sys/stat.h>
+#include "CsvMap.h"
+
+#define SNAP_MAGIC "LEGOCOL1"
+#define SNAP_VERSION 1
+#define SNAP_MAX_COLUMNS 16
+
+typedef enum {
+    SNAP_INT = 0,  // int32，按atoi规则转换
+    SNAP_STR = 1   // 字典编码的字符串
+} SnapColumnType;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t column_count;
+    uint64_t csv_size;
+    int64_t csv_mtime_sec;
+    int64_t csv_mtime_nsec;
+    uint64_t row_count;
+    uint64_t reserved[2];
+} SnapHeader;
+
+typedef struct {
+    uint32_t type;
+    uint32_t dict_count;
+    uint64_t data_offset;          // 整数值或字符串编码
+    uint64_t dict_offsets_offset;  // 字符串列：各字典项在正文中的起始位置
+    uint64_t dict_bytes_offset;    // 字符串列：字典正文
+} SnapColumnDesc;
+
+// 映射后的一列
+typedef struct {
+    SnapColumnType type;
+    uint32_t dict_count;
+    const int32_t *ints;
+    const uint32_t *codes;
+    const uint32_t *dict_offsets;
+    const char *dict_bytes;
+} SnapColumn;
+
+// 映射后的一张表
+typedef struct {
+    CsvFile file;
+    int row_count;
+    int column_count;
+    SnapColumn columns[SNAP_MAX_COLUMNS];
+} SnapTable;
+
+static inline int snap_int(const SnapTable *table, int col, int row) {
+    return table->columns[col].ints[row];
+}
+
+static inline StrView snap_dict_entry(const SnapColumn *column, uint32_t code) {
+    StrView sv;
+    sv.ptr = column->dict_bytes + column->dict_offsets[code];
+    sv.len = (int)(column->dict_offsets[code + 1] - column->dict_offsets[code]);
+    return sv;
+}
+
+static inline StrView snap_str(const SnapTable *table, int col, int row) {
+    const SnapColumn *column = &table->columns[col];
+    return snap_dict_entry(column, column->codes[row]);
+}
+
+static inline void snap_close(SnapTable *table) {
+    csv_close(&table->file);
+}
+
+// ---------- 构建 ----------
+
+// 构建时单个字符串列的字典：开放寻址表存"编码+1"，正文连续存放
+typedef struct {
+    uint32_t *slots;
+    uint32_t slot_mask;
+    char *bytes;
+    size_t bytes_len, bytes_cap;
+    uint32_t *offsets;  // offsets[i]为第i项的起始位置，最后多一项为结束位置
+    uint32_t count, offsets_cap;
+} SnapDictBuilder;
+
+static inline uint32_t snap_hash(const char *p, int len) {
+    uint32_t h = 2166136261u;  // FNV-1a
+    for (int i = 0; i < len; i++) {
+        h ^= (unsigned char)p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static inline int snap_dict_init(SnapDictBuilder *dict) {
+    memset(dict, 0, sizeof(*dict));
+    dict->slot_mask = 1023;
+    dict->slots = (uint32_t*)calloc(dict->slot_mask + 1, sizeof(uint32_t));
+    dict->bytes_cap = 4096;
+    dict->bytes = (char*)malloc(dict->bytes_cap);
+    dict->offsets_cap = 1024;
+    dict->offsets = (uint32_t*)malloc(dict->offsets_cap * sizeof(uint32_t));
+    if (!dict->slots || !dict->bytes || !dict->offsets) return -1;
+    dict->offsets[0] = 0;
+    return 0;
+}
+
+static inline void snap_dict_free(SnapDictBuilder *dict) {
+    free(dict->slots);
+    free(dict->bytes);
+    free(dict->offsets);
+}
+
+static inline int snap_dict_grow_slots(SnapDictBuilder *dict) {
+    uint32_t new_mask = dict->slot_mask * 2 + 1;
+    uint32_t *slots = (uint32_t*)calloc(new_mask + 1, sizeof(uint32_t));
+    if (!slots) return -1;
+    for (uint32_t code = 0; code < dict->count; code++) {
+        uint32_t start = dict->offsets[code];
+        uint32_t h = snap_hash(dict->bytes + start, (int)(dict->offsets[code + 1] - start));
+        uint32_t i = h & new_mask;
+        while (slots[i]) i = (i + 1) & new_mask;
+        slots[i] = code + 1;
+    }
+    free(dict->slots);
+    dict->slots = slots;
+    dict->slot_mask = new_mask;
+    return 0;
+}
+
+// 返回字符串的编码，新字符串追加到字典末尾；内存不足返回UINT32_MAX
+static inline uint32_t snap_dict_intern(SnapDictBuilder *dict, StrView sv) {
+    uint32_t h = snap_hash(sv.ptr, sv.len);
+    uint32_t i = h & dict->slot_mask;
+    while (dict->slots[i]) {
+        uint32_t code = dict->slots[i] - 1;
+        uint32_t start = dict->offsets[code];
+        if (dict->offsets[code + 1] - start == (uint32_t)sv.len &&
+            memcmp(dict->bytes + start, sv.ptr, sv.len) == 0) {
+            return code;
+        }
+        i = (i + 1) & dict->slot_mask;
+    }
+
+    if (dict->bytes_len + sv.len > dict->bytes_cap) {
+        size_t cap = dict->bytes_cap * 2;
+        while (cap < dict->bytes_len + sv.len) cap *= 2;
+        char *bytes = (char*)realloc(dict->bytes, cap);
+        if (!bytes) return UINT32_MAX;
+        dict->bytes = bytes;
+        dict->bytes_cap = cap;
+    }
+    if (dict->count + 2 > dict->offsets_cap) {
+        uint32_t *offsets = (uint32_t*)realloc(dict->offsets, dict->offsets_cap * 2 * sizeof(uint32_t));
+        if (!offsets) return UINT32_MAX;
+        dict->offsets = offsets;
+        dict->offsets_cap *= 2;
+    }
+    memcpy(dict->bytes + dict->bytes_len, sv.ptr, sv.len);
+    dict->bytes_len += sv.len;
+    uint32_t code = dict->count++;
+    dict->offsets[dict->count] = (uint32_t)dict->bytes_len;
+    dict->slots[i] = code + 1;
+
+    // 负载因子超过0.5时扩容
+    if (dict->count * 2 > dict->slot_mask && snap_dict_grow_slots(dict) != 0) return UINT32_MAX;
+    return code;
+}
+
+// 写入并按8字节补齐
+static inline int snap_write_padded(FILE *fp, const void *data, size_t size, uint64_t *offset) {
+    static const char zeros[8] = {0};
+    if (size > 0 && fwrite(data, 1, size, fp) != size) return -1;
+    size_t pad = (8 - size % 8) % 8;
+    if (pad > 0 && fwrite(zeros, 1, pad, fp) != pad) return -1;
+    *offset += size + pad;
+    return 0;
+}
+
+// 解析CSV（跳过表头和空行）并写出快照文件，成功返回0
+static inline int snap_build(const char *csv_path, const char *snap_path, const struct stat *csv_stat,
+                             const SnapColumnType *schema, int column_count) {
+    CsvFile csv;
+    if (csv_open(&csv, csv_path) != 0) return -1;
+
+    int capacity = csv_count_lines(&csv);
+    int32_t *values[SNAP_MAX_COLUMNS] = {0};  // 整数值或字符串编码
+    SnapDictBuilder dicts[SNAP_MAX_COLUMNS];
+    int ok = 1;
+    for (int c = 0; c < column_count; c++) {
+        values[c] = (int32_t*)malloc((capacity > 0 ? capacity : 1) * sizeof(int32_t));
+        memset(&dicts[c], 0, sizeof(SnapDictBuilder));
+        if (!values[c] || (schema[c] == SNAP_STR && snap_dict_init(&dicts[c]) != 0)) ok = 0;
+    }
+
+    // 表头和空行的判断与CSV直接解析（CsvParallel.h）一致，两条路径得到的行相同
+    int rows = 0;
+    CsvCursor cursor;
+    StrView line, field;
+    size_t body = csv_body_offset(&csv);
+    csv_cursor_init_range(&cursor, csv.data + body, csv.size - body);
+    while (ok && csv_next_line(&cursor, &line)) {
+        if (csv_line_empty(line)) continue;
+        for (int c = 0; c < column_count; c++) {
+            if (!csv_next_field(&cursor, &field)) {
+                field.ptr = line.ptr;
+                field.len = 0;
+            }
+            if (schema[c] == SNAP_INT) {
+                values[c][rows] = sv_to_int(field);
+            } else {
+                uint32_t code = snap_dict_intern(&dicts[c], field);
+                if (code == UINT32_MAX) ok = 0;
+                values[c][rows] = (int32_t)code;
+            }
+        }
+        rows++;
+    }
+    csv_close(&csv);
+
+    // 先写临时文件再改名，避免其他进程读到写了一半的快照
+    char tmp_path[1024 + 32];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp%ld", snap_path, (long)getpid());
+    FILE *fp = ok ? fopen(tmp_path, "wb") : NULL;
+    if (fp) {
+        SnapHeader header;
+        SnapColumnDesc descs[SNAP_MAX_COLUMNS];
+        memset(&header, 0, sizeof(header));
+        memset(descs, 0, sizeof(descs));
+        memcpy(header.magic, SNAP_MAGIC, 8);
+        header.version = SNAP_VERSION;
+        header.column_count = (uint32_t)column_count;
+        header.csv_size = (uint64_t)csv_stat->st_size;
+        header.csv_mtime_sec = (int64_t)csv_stat->st_mtim.tv_sec;
+        header.csv_mtime_nsec = (int64_t)csv_stat->st_mtim.tv_nsec;
+        header.row_count = (uint64_t)rows;
+
+        // 先算好各段偏移，再顺序写出
+        uint64_t offset = sizeof(SnapHeader) + column_count * sizeof(SnapColumnDesc);
+        for (int c = 0; c < column_count; c++) {
+            descs[c].type = schema[c];
+            descs[c].data_offset = offset;
+            offset += ((uint64_t)rows * 4 + 7) / 8 * 8;
+            if (schema[c] == SNAP_STR) {
+                descs[c].dict_count = dicts[c].count;
+                descs[c].dict_offsets_offset = offset;
+                offset += ((uint64_t)(dicts[c].count + 1) * 4 + 7) / 8 * 8;
+                descs[c].dict_bytes_offset = offset;
+                offset += (dicts[c].bytes_len + 7) / 8 * 8;
+            }
+        }
+
+        uint64_t written = 0;
+        int failed = snap_write_padded(fp, &header, sizeof(header), &written) != 0 ||
+                     snap_write_padded(fp, descs, column_count * sizeof(SnapColumnDesc), &written) != 0;
+        for (int c = 0; c < column_count && !failed; c++) {
+            failed |= snap_write_padded(fp, values[c], (size_t)rows * 4, &written) != 0;
+            if (schema[c] == SNAP_STR) {
+                failed |= snap_write_padded(fp, dicts[c].offsets, (size_t)(dicts[c].count + 1) * 4, &written) != 0;
+                failed |= snap_write_padded(fp, dicts[c].bytes, dicts[c].bytes_len, &written) != 0;
+            }
+        }
+        failed |= fclose(fp) != 0;
+        if (failed || rename(tmp_path, snap_path) != 0) {
+            remove(tmp_path);
+            ok = 0;
+        }
+    } else {
+        ok = 0;
+    }
+
+    for (int c = 0; c < column_count; c++) {
+        free(values[c]);
+        if (schema[c] == SNAP_STR) snap_dict_free(&dicts[c]);
+    }
+    return ok ? 0 : -1;
+}
+
+// ---------- 打开与校验 ----------
+
+// 映射快照并检查魔数、版本、CSV大小与修改时间、列结构、各段是否越界以及字典编码是否有效，
+// 任何一项不对都返回-1（调用方重建快照或退回CSV解析）
+static inline int snap_map(SnapTable *table, const char *snap_path, const struct stat *csv_stat,
+                           const SnapColumnType *schema, int column_count) {
+    if (csv_open(&table->file, snap_path) != 0) return -1;
+
+    const char *base = table->file.data;
+    uint64_t size = table->file.size;
+    const SnapHeader *header = (const SnapHeader*)base;
+    if (size < sizeof(SnapHeader) || memcmp(header->magic, SNAP_MAGIC, 8) != 0 ||
+        header->version != SNAP_VERSION || header->column_count != (uint32_t)column_count ||
+        header->csv_size != (uint64_t)csv_stat->st_size ||
+        header->csv_mtime_sec != (int64_t)csv_stat->st_mtim.tv_sec ||
+        header->csv_mtime_nsec != (int64_t)csv_stat->st_mtim.tv_nsec ||
+        header->row_count > INT32_MAX ||
+        size < sizeof(SnapHeader) + column_count * sizeof(SnapColumnDesc)) {
+        csv_close(&table->file);
+        return -1;
+    }
+
+    const SnapColumnDesc *descs = (const SnapColumnDesc*)(base + sizeof(SnapHeader));
+    uint64_t rows = header->row_count;
+    for (int c = 0; c < column_count; c++) {
+        const SnapColumnDesc *d = &descs[c];
+        SnapColumn *column = &table->columns[c];
+        int bad = d->type != (uint32_t)schema[c] || d->data_offset % 8 != 0 ||
+                  d->data_offset > size || rows * 4 > size - d->data_offset;
+        if (!bad && d->type == SNAP_STR) {
+            bad = d->dict_offsets_offset % 8 != 0 || d->dict_offsets_offset > size ||
+                  ((uint64_t)d->dict_count + 1) * 4 > size - d->dict_offsets_offset ||
+                  d->dict_bytes_offset > size;
+        }
+        if (!bad && d->type == SNAP_STR) {
+            // snap_str按编码直接下标访问，所以字典偏移必须从0起单调不减且不越界，每个编码都要小于字典项数
+            const uint32_t *offsets = (const uint32_t*)(base + d->dict_offsets_offset);
+            const uint32_t *codes = (const uint32_t*)(base + d->data_offset);
+            bad = offsets[0] != 0 || offsets[d->dict_count] > size - d->dict_bytes_offset;
+            for (uint32_t k = 0; !bad && k < d->dict_count; k++) bad = offsets[k] > offsets[k + 1];
+            for (uint64_t r = 0; !bad && r < rows; r++) bad = codes[r] >= d->dict_count;
+        }
+        if (bad) {
+            csv_close(&table->file);
+            return -1;
+        }
+        column->type = schema[c];
+        column->dict_count = d->dict_count;
+        column->ints = (const int32_t*)(base + d->data_offset);
+        column->codes = (const uint32_t*)(base + d->data_offset);
+        column->dict_offsets = (const uint32_t*)(base + d->dict_offsets_offset);
+        column->dict_bytes = base + d->dict_bytes_offset;
+    }
+    table->row_count = (int)rows;
+    table->column_count = column_count;
+    return 0;
+}
+
+// 打开csv_path对应的快照；快照不存在或已过期时从CSV重建。
+// 成功返回0；CSV不存在或快照无法写入时返回-1，调用方应退回CSV解析
+static inline int snap_open(SnapTable *table, const char *csv_path, const SnapColumnType *schema, int column_count) {
+    struct stat csv_stat;
+    char snap_path[1024];
+    memset(table, 0, sizeof(*table));
+    if (column_count > SNAP_MAX_COLUMNS || strlen(csv_path) + 6 > sizeof(snap_path) ||
+        stat(csv_path, &csv_stat) != 0) return -1;
+    snprintf(snap_path, sizeof(snap_path), "%s.snap", csv_path);
+
+    if (snap_map(table, snap_path, &csv_stat, schema, column_count) == 0) return 0;
+    if (snap_build(csv_path, snap_path, &csv_stat, schema, column_count) != 0) return -1;
+    return snap_map(table, snap_path, &csv_stat, schema, column_count);
+}
+
+#endif
@@ -0,0 +1,410 @@
+#ifndef CSV_MAP_H
+#define CSV_MAP_H
+
+// 共享的CSV读取模块：整个文件mmap到内存，行和字段的边界由CsvSimd.h的向量化扫描在映射区里找出，
+// 交给调用方的是指向映射区的字符串视图（StrView），只有调用方需要时才拷贝。
+// 所有函数都是static inline，各个程序直接 #include "CsvMap.h" 即可单文件编译。
+// 读取方式（csv_read_mode）和打开过的文件登记表供基准测试的缓存模式使用（见Bench.h）。
+// direct读取方式用到的O_DIRECT需要_GNU_SOURCE，由各程序在第一个#include之前定义。
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "CsvSimd.h"
+
+#ifdef _WIN32
+#define CSV_MAP_NO_MMAP
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// 字符串视图：不以'\0'结尾，长度由len给出
+typedef struct {
+    const char *ptr;
+    int len;
+} StrView;
+
+// 映射后的CSV文件
+typedef struct {
+    const char *data;
+    size_t size;
+    int mapped;  // 1=mmap得到，需要munmap；0=malloc得到（Windows、空文件或O_DIRECT读入）；2=借用常驻内容，不释放
+} CsvFile;
+
+// 读取方式，默认mmap；基准测试按缓存模式设置
+typedef enum {
+    CSV_READ_MMAP = 0,     // mmap映射，数据经过页缓存
+    CSV_READ_DIRECT = 1,   // O_DIRECT读入对齐的缓冲区，不经过页缓存（文件系统不支持时退回普通read）
+    CSV_READ_RESIDENT = 2  // 第一次打开时整份读入内存并一直保留，以后再打开直接借用，没有任何I/O
+} CsvReadMode;
+
+#define CSV_MAX_TRACKED 64
+#define CSV_PATH_MAX 1024
+#define CSV_IO_BLOCK 4096  // O_DIRECT的对齐单位
+
+// 打开过的文件。冷缓存模式每次测试前据此把它们清出页缓存（包括快照这类由读取模块间接打开的文件），
+// 常驻模式在这里保存文件内容。只有csv_tracking为1（Bench.h选了冷缓存、direct或常驻模式）时才登记，
+// 平时打开文件不碰登记表。多个线程可能同时打开文件，登记表用自旋锁保护
+typedef struct {
+    char path[CSV_PATH_MAX];
+    char *data;   // 常驻模式下的文件内容，否则为NULL
+    size_t size;
+} CsvTracked;
+
+static CsvReadMode csv_read_mode = CSV_READ_MMAP;
+static int csv_tracking;
+static CsvTracked csv_tracked[CSV_MAX_TRACKED];
+static int csv_tracked_count;
+static char csv_tracked_busy;
+
+#ifndef CSV_MAP_NO_MMAP
+static inline void csv_tracked_lock(void) {
+    while (__atomic_test_and_set(&csv_tracked_busy, __ATOMIC_ACQUIRE)) {
+    }
+}
+
+static inline void csv_tracked_unlock(void) {
+    __atomic_clear(&csv_tracked_busy, __ATOMIC_RELEASE);
+}
+
+// 查找或登记一个文件（调用方持有锁），返回下标；表满或路径太长返回-1，这个文件不参与缓存模式
+static inline int csv_track(const char *path) {
+    for (int i = 0; i < csv_tracked_count; i++) {
+        if (strcmp(csv_tracked[i].path, path) == 0) return i;
+    }
+    if (csv_tracked_count == CSV_MAX_TRACKED || strlen(path) >= CSV_PATH_MAX) return -1;
+    CsvTracked *entry = &csv_tracked[csv_tracked_count];
+    strcpy(entry->path, path);
+    entry->data = NULL;
+    entry->size = 0;
+    return csv_tracked_count++;
+}
+
+// 把整个文件读进新分配的缓冲区。direct为1时fd带O_DIRECT：缓冲区和每次读的长度都按块对齐，
+// 读到一半报EINVAL（文件系统不支持）就去掉O_DIRECT接着读。成功返回缓冲区（可用free释放）
+static inline char* csv_read_all(int fd, size_t size, int direct) {
+    size_t cap = (size + CSV_IO_BLOCK - 1) / CSV_IO_BLOCK * CSV_IO_BLOCK;
+    void *buf = NULL;
+    if (cap == 0) cap = CSV_IO_BLOCK;
+    if (posix_memalign(&buf, CSV_IO_BLOCK, cap) != 0) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = read(fd, (char*)buf + done, direct ? cap - done : size - done);
+        if (n < 0 && errno == EINTR) continue;
+#ifdef O_DIRECT
+        if (n < 0 && errno == EINVAL && direct) {
+            int flags = fcntl(fd, F_GETFL);
+            if (flags != -1 && fcntl(fd, F_SETFL, flags & ~O_DIRECT) == 0) {
+                direct = 0;
+                continue;
+            }
+        }
+#endif
+        if (n <= 0) {
+            if (n == 0) errno = EIO;  // 文件在读取期间变短
+            free(buf);
+            return NULL;
+        }
+        done += (size_t)n;
+    }
+    return (char*)buf;
+}
+#endif
+
+// 打开并映射文件，成功返回0，失败返回-1（errno保留失败原因）
+static inline int csv_open(CsvFile *file, const char *filename) {
+    file->data = NULL;
+    file->size = 0;
+    file->mapped = 0;
+#ifdef CSV_MAP_NO_MMAP
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return -1;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *buf = (char*)malloc(size > 0 ? size : 1);
+    if (!buf || (size > 0 && fread(buf, 1, size, fp) != (size_t)size)) {
+        free(buf);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    file->data = buf;
+    file->size = size;
+    return 0;
+#else
+    CsvReadMode mode = csv_read_mode;
+    int slot = -1;
+    if (csv_tracking) {
+        csv_tracked_lock();
+        slot = csv_track(filename);
+        if (slot >= 0 && csv_tracked[slot].data) {
+            file->data = csv_tracked[slot].data;
+            file->size = csv_tracked[slot].size;
+            file->mapped = 2;
+            csv_tracked_unlock();
+            return 0;
+        }
+        csv_tracked_unlock();
+    }
+
+    int direct = 0;
+    int fd = -1;
+#ifdef O_DIRECT
+    if (mode == CSV_READ_DIRECT) {
+        fd = open(filename, O_RDONLY | O_DIRECT);
+        direct = fd >= 0;
+    }
+#endif
+    if (fd < 0) fd = open(filename, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    file->size = (size_t)st.st_size;
+    if (mode != CSV_READ_MMAP) {
+        char *data = csv_read_all(fd, file->size, direct);
+        close(fd);
+        if (!data) return -1;
+        file->data = data;
+        if (mode == CSV_READ_RESIDENT && slot >= 0) {
+            // 另一个线程可能同时读入了同一个文件，只保留先登记的那份
+            csv_tracked_lock();
+            if (csv_tracked[slot].data) {
+                free(data);
+            } else {
+                csv_tracked[slot].data = data;
+                csv_tracked[slot].size = file->size;
+            }
+            file->data = csv_tracked[slot].data;
+            file->mapped = 2;
+            csv_tracked_unlock();
+        }
+        return 0;
+    }
+    if (file->size == 0) {
+        // 空文件不能mmap，给一个空缓冲区
+        close(fd);
+        file->data = (const char*)calloc(1, 1);
+        return file->data ? 0 : -1;
+    }
+    void *addr = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return -1;
+    madvise(addr, file->size, MADV_SEQUENTIAL);
+    file->data = (const char*)addr;
+    file->mapped = 1;
+    return 0;
+#endif
+}
+
+static inline void csv_close(CsvFile *file) {
+#ifndef CSV_MAP_NO_MMAP
+    if (file->mapped == 1) {
+        munmap((void*)file->data, file->size);
+    } else
+#endif
+    if (file->mapped == 0) {
+        free((void*)file->data);
+    }
+    file->data = NULL;
+    file->size = 0;
+    file->mapped = 0;
+}
+
+// 把一个文件清出页缓存：先写回脏页（DONTNEED丢不掉脏页），再通知内核丢弃。失败返回-1
+static inline int csv_evict(const char *path) {
+#ifdef CSV_MAP_NO_MMAP
+    (void)path;
+    return -1;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    fdatasync(fd);
+    int rc = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    return rc == 0 ? 0 : -1;
+#endif
+}
+
+// 把一个文件完整读一遍，保证它在页缓存里。失败返回-1
+static inline int csv_prefetch(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return -1;
+    static char sink[1 << 16];
+    while (fread(sink, 1, sizeof(sink), fp) == sizeof(sink)) {
+    }
+    int rc = ferror(fp) ? -1 : 0;
+    fclose(fp);
+    return rc;
+}
+
+// 对登记表中每个打开过的文件调用fn（冷缓存模式传csv_evict；热缓存模式不登记，登记表为空）
+static inline void csv_for_each_tracked(int (*fn)(const char *path)) {
+#ifndef CSV_MAP_NO_MMAP
+    char path[CSV_PATH_MAX];
+    for (int i = 0;; i++) {
+        csv_tracked_lock();
+        int more = i < csv_tracked_count;
+        if (more) strcpy(path, csv_tracked[i].path);
+        csv_tracked_unlock();
+        if (!more) break;
+        fn(path);
+    }
+#else
+    (void)fn;
+#endif
+}
+
+// 释放常驻模式保存的文件内容（之后不能再使用借用它们的CsvFile）
+static inline void csv_release_resident(void) {
+    for (int i = 0; i < csv_tracked_count; i++) {
+        free(csv_tracked[i].data);
+        csv_tracked[i].data = NULL;
+        csv_tracked[i].size = 0;
+    }
+}
+
+// 统计行数（含表头），用于一次性分配数组；引号内的换行也会计入，所以是上界
+static inline int csv_count_lines(const CsvFile *file) {
+    int count = 0;
+    const char *p = file->data;
+    const char *end = file->data + file->size;
+    while (p < end) {
+        const char *nl = (const char*)memchr(p, '\n', end - p);
+        count++;
+        if (!nl) break;
+        p = nl + 1;
+    }
+    return count;
+}
+
+// 表头之后第一行的起点：表头只认第一个换行，并行解析的切分和快照构建都按这个规则
+static inline size_t csv_body_offset(const CsvFile *file) {
+    const char *nl = (const char*)memchr(file->data, '\n', file->size);
+    return nl ? (size_t)(nl + 1 - file->data) : file->size;
+}
+
+// 空行（去掉行尾\r后为空）不是数据行，所有读表的路径都跳过它
+static inline int csv_line_empty(StrView line) {
+    return line.len == 0;
+}
+
+#define CSV_MAX_FIELDS 16  // 每行最多切分的字段数，超出部分并入最后一个字段
+
+// 行游标：依次取出每一行（不含行尾的\r\n），同时记下这一行各字段的边界
+typedef struct {
+    CsvScanner scanner;
+    size_t pos;                       // 下一行的起始偏移
+    StrView fields[CSV_MAX_FIELDS];   // 当前行的字段（原样保留引号）
+    int field_count;
+    int field_next;                   // csv_next_field下一次返回的字段
+} CsvCursor;
+
+// 在任意一段缓冲区上建立游标，起点须为行首
+static inline void csv_cursor_init_range(CsvCursor *cursor, const char *data, size_t size) {
+    csv_scanner_init(&cursor->scanner, data, size);
+    cursor->pos = 0;
+    cursor->field_count = 0;
+    cursor->field_next = 0;
+}
+
+static inline void csv_cursor_init(CsvCursor *cursor, const CsvFile *file) {
+    csv_cursor_init_range(cursor, file->data, file->size);
+}
+
+// 取下一行，返回0表示结束；引号内的换行和逗号不算分隔符
+static inline int csv_next_line(CsvCursor *cursor, StrView *line) {
+    const char *data = cursor->scanner.data;
+    size_t size = cursor->scanner.size;
+    size_t start = cursor->pos;
+    if (start >= size) return 0;
+
+    size_t field_start = start;
+    size_t pos;
+    int count = 0;
+    for (;;) {
+        char c = csv_scan_next(&cursor->scanner, &pos);
+        if (c == 0) {
+            pos = size;  // 最后一行没有换行符
+            break;
+        }
+        if (c == '\n') break;
+        if (count < CSV_MAX_FIELDS - 1) {
+            cursor->fields[count].ptr = data + field_start;
+            cursor->fields[count].len = (int)(pos - field_start);
+            count++;
+            field_start = pos + 1;
+        }
+    }
+    cursor->pos = pos + 1;
+
+    size_t line_end = pos;
+    if (line_end > start && data[line_end - 1] == '\r') line_end--;
+    if (field_start > line_end) field_start = line_end;
+    cursor->fields[count].ptr = data + field_start;
+    cursor->fields[count].len = (int)(line_end - field_start);
+    cursor->field_count = count + 1;
+    cursor->field_next = 0;
+
+    line->ptr = data + start;
+    line->len = (int)(line_end - start);
+    return 1;
+}
+
+// 依次取出当前行的下一个字段，返回0表示该行已没有字段
+static inline int csv_next_field(CsvCursor *cursor, StrView *field) {
+    if (cursor->field_next >= cursor->field_count) return 0;
+    *field = cursor->fields[cursor->field_next++];
+    return 1;
+}
+
+// 去掉字段外层的一对引号
+static inline StrView sv_unquote(StrView sv) {
+    if (sv.len >= 2 && sv.ptr[0] == '"' && sv.ptr[sv.len - 1] == '"') {
+        sv.ptr++;
+        sv.len -= 2;
+    }
+    return sv;
+}
+
+// 与atoi行为一致：跳过前导空白，可带符号，遇到非数字停止
+static inline int sv_to_int(StrView sv) {
+    const char *p = sv.ptr;
+    const char *end = sv.ptr + sv.len;
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        neg = (*p == '-');
+        p++;
+    }
+    int value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p - '0');
+        p++;
+    }
+    return neg ? -value : value;
+}
+
+static inline int sv_equals(StrView sv, const char *str) {
+    size_t n = strlen(str);
+    return (size_t)sv.len == n && memcmp(sv.ptr, str, n) == 0;
+}
+
+// 拷贝到定长缓冲区，超长截断，保证'\0'结尾
+static inline void sv_copy(StrView sv, char *dest, size_t dest_size) {
+    size_t n = (size_t)sv.len < dest_size - 1 ? (size_t)sv.len : dest_size - 1;
+    memcpy(dest, sv.ptr, n);
+    dest[n] = '\0';
+}
+
+#endif
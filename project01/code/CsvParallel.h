@@ -0,0 +1,127 @@
+#ifndef CSV_PARALLEL_H
+#define CSV_PARALLEL_H
+
+// 大CSV文件的并行解析：跳过表头后把文件按字节切成若干段，每段的边界挪到下一个
+// 换行之后，由线程池分段解析到各自的数组，最后按文件顺序拼接，结果与串行解析完全一致。
+// 切分点只认换行符，要求换行不出现在引号字段内（inventory_parts/parts等表满足）。
+
+#include "CsvMap.h"
+#include "ThreadPool.h"
+
+#define CSV_PARALLEL_MIN_CHUNK (1 << 20)  // 每段至少1MB，小文件直接串行解析
+#define CSV_PARALLEL_MAX_CHUNKS 64
+
+// 行解析回调：把当前行解析到row中，返回1表示保留该行，0表示跳过；ctx原样传入
+typedef int (*CsvRowParser)(CsvCursor *cursor, StrView line, void *row, void *ctx);
+
+typedef struct {
+    const char *data;      // 本段起点（行首）
+    size_t size;
+    size_t row_size;
+    CsvRowParser parse;
+    void *ctx;
+    char *rows;            // 本段解析结果
+    int count;
+    int failed;
+} CsvChunk;
+
+static inline void csv_parse_chunk(void *arg) {
+    CsvChunk *chunk = (CsvChunk*)arg;
+    CsvFile view = { chunk->data, chunk->size, 0 };
+    int capacity = csv_count_lines(&view);
+
+    chunk->count = 0;
+    chunk->rows = (char*)malloc((capacity > 0 ? capacity : 1) * chunk->row_size);
+    if (!chunk->rows) {
+        chunk->failed = 1;
+        return;
+    }
+
+    CsvCursor cursor;
+    StrView line;
+    csv_cursor_init_range(&cursor, chunk->data, chunk->size);
+    while (csv_next_line(&cursor, &line)) {
+        char *row = chunk->rows + (size_t)chunk->count * chunk->row_size;
+        if (chunk->parse(&cursor, line, row, chunk->ctx)) chunk->count++;
+    }
+}
+
+// 解析整个文件（跳过表头），结果数组通过rows_out传出（调用方free），
+// 返回行数；打开失败或内存不足返回-1
+static inline int csv_parse_parallel(const CsvFile *file, size_t row_size, CsvRowParser parse, void *ctx,
+                                     void **rows_out) {
+    *rows_out = NULL;
+
+    // 跳过表头
+    const char *begin = file->data + csv_body_offset(file);
+    const char *end = file->data + file->size;
+    size_t body = (size_t)(end - begin);
+
+    // 按线程数和最小段长决定分段数
+    ThreadPool *pool = thread_pool_shared();
+    int chunk_count = pool ? pool->thread_count : 1;
+    if ((size_t)chunk_count > body / CSV_PARALLEL_MIN_CHUNK) chunk_count = (int)(body / CSV_PARALLEL_MIN_CHUNK);
+    if (chunk_count > CSV_PARALLEL_MAX_CHUNKS) chunk_count = CSV_PARALLEL_MAX_CHUNKS;
+    if (chunk_count < 1) chunk_count = 1;
+
+    CsvChunk chunks[CSV_PARALLEL_MAX_CHUNKS];
+    const char *start = begin;
+    for (int i = 0; i < chunk_count; i++) {
+        const char *stop = end;
+        if (i < chunk_count - 1) {
+            stop = begin + body / chunk_count * (i + 1);
+            if (stop < start) stop = start;
+            const char *next = (const char*)memchr(stop, '\n', end - stop);
+            stop = next ? next + 1 : end;
+        }
+        chunks[i].data = start;
+        chunks[i].size = (size_t)(stop - start);
+        chunks[i].row_size = row_size;
+        chunks[i].parse = parse;
+        chunks[i].ctx = ctx;
+        chunks[i].rows = NULL;
+        chunks[i].count = 0;
+        chunks[i].failed = 0;
+        start = stop;
+    }
+
+    if (chunk_count == 1) {
+        csv_parse_chunk(&chunks[0]);
+    } else {
+        TaskGroup group = {0};
+        for (int i = 0; i < chunk_count; i++) {
+            thread_pool_submit(pool, &group, csv_parse_chunk, &chunks[i]);
+        }
+        task_group_wait(pool, &group);
+    }
+
+    // 按文件顺序拼接各段结果；只有一段时直接把该段数组交给调用方
+    int total = 0, failed = 0;
+    for (int i = 0; i < chunk_count; i++) {
+        total += chunks[i].count;
+        failed |= chunks[i].failed;
+    }
+    char *rows = NULL;
+    if (!failed) {
+        if (chunk_count == 1) {
+            rows = chunks[0].rows;
+            chunks[0].rows = NULL;
+        } else {
+            rows = (char*)malloc((total > 0 ? total : 1) * row_size);
+            if (rows) {
+                size_t offset = 0;
+                for (int i = 0; i < chunk_count; i++) {
+                    memcpy(rows + offset, chunks[i].rows, (size_t)chunks[i].count * row_size);
+                    offset += (size_t)chunks[i].count * row_size;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < chunk_count; i++) free(chunks[i].rows);
+
+    if (!rows) return -1;
+    *rows_out = rows;
+    return total;
+}
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef CSV_SIMD_H
+#define CSV_SIMD_H
+
+// 向量化的CSV结构字符扫描：每次处理64字节，生成逗号/引号/换行三张位图，
+// 再用前缀异或算出引号内的区域，把引号内的逗号和换行屏蔽掉。
+// 运行时根据CPU选择AVX2或SSE2实现，其他平台走逐字节的标量实现。
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CSV_SIMD_X86
+#endif
+
+// 一个64字节块中三类字符的位图，第i位对应块内第i个字节
+typedef struct {
+    uint64_t comma;
+    uint64_t quote;
+    uint64_t newline;
+} CsvMasks;
+
+typedef void (*CsvMaskFn)(const char *block, CsvMasks *masks);
+
+static inline void csv_masks_scalar(const char *block, CsvMasks *masks) {
+    uint64_t comma = 0, quote = 0, newline = 0;
+    for (int i = 0; i < 64; i++) {
+        uint64_t bit = 1ULL << i;
+        comma |= (block[i] == ',') ? bit : 0;
+        quote |= (block[i] == '"') ? bit : 0;
+        newline |= (block[i] == '\n') ? bit : 0;
+    }
+    masks->comma = comma;
+    masks->quote = quote;
+    masks->newline = newline;
+}
+
+#ifdef CSV_SIMD_X86
+__attribute__((target("sse2")))
+static void csv_masks_sse2(const char *block, CsvMasks *masks) {
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i newline = _mm_set1_epi8('\n');
+    uint64_t c = 0, q = 0, n = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+        c |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, comma)) << (16 * i);
+        q |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << (16 * i);
+        n |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)) << (16 * i);
+    }
+    masks->comma = c;
+    masks->quote = q;
+    masks->newline = n;
+}
+
+__attribute__((target("avx2")))
+static void csv_masks_avx2(const char *block, CsvMasks *masks) {
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    __m256i lo = _mm256_loadu_si256((const __m256i*)block);
+    __m256i hi = _mm256_loadu_si256((const __m256i*)(block + 32));
+    masks->comma = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, comma))
+                 | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, comma)) << 32;
+    masks->quote = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, quote))
+                 | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, quote)) << 32;
+    masks->newline = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline))
+                   | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline)) << 32;
+}
+#endif
+
+// 首次调用时按CPU能力选实现；多个线程可能同时初始化，写入的是同一个值，用原子读写即可
+static inline CsvMaskFn csv_masks_fn(void) {
+    static CsvMaskFn fn = NULL;
+    CsvMaskFn picked = __atomic_load_n(&fn, __ATOMIC_ACQUIRE);
+    if (!picked) {
+        picked = csv_masks_scalar;
+#ifdef CSV_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            picked = csv_masks_avx2;
+        } else if (__builtin_cpu_supports("sse2")) {
+            picked = csv_masks_sse2;
+        }
+#endif
+        __atomic_store_n(&fn, picked, __ATOMIC_RELEASE);
+    }
+    return picked;
+}
+
+// 前缀异或：第i位 = 第0..i位的异或，用来把引号位图变成"在引号内"的区域位图
+static inline uint64_t csv_prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// 结构字符扫描器：按顺序给出引号外的逗号和换行的位置
+typedef struct {
+    const char *data;
+    size_t size;
+    size_t block;          // 当前块的起始偏移
+    uint64_t comma;        // 当前块里还没取出的逗号位
+    uint64_t newline;      // 当前块里还没取出的换行位
+    uint64_t quote_carry;  // 上一块结束时是否在引号内（全0或全1）
+    CsvMaskFn masks;
+} CsvScanner;
+
+static inline void csv_scan_block(CsvScanner *scanner) {
+    CsvMasks m;
+    size_t remain = scanner->size - scanner->block;
+    if (remain >= 64) {
+        scanner->masks(scanner->data + scanner->block, &m);
+    } else {
+        // 最后不足64字节的尾块补零后再扫描，补的零不会产生结构位
+        char tail[64];
+        memcpy(tail, scanner->data + scanner->block, remain);
+        memset(tail + remain, 0, 64 - remain);
+        scanner->masks(tail, &m);
+    }
+    uint64_t inside = csv_prefix_xor(m.quote) ^ scanner->quote_carry;
+    scanner->quote_carry = (uint64_t)((int64_t)inside >> 63);
+    scanner->comma = m.comma & ~inside;
+    scanner->newline = m.newline & ~inside;
+}
+
+// 扫描区间的起点必须在引号外（文件开头或某一行的行首）
+static inline void csv_scanner_init(CsvScanner *scanner, const char *data, size_t size) {
+    scanner->data = data;
+    scanner->size = size;
+    scanner->block = 0;
+    scanner->comma = 0;
+    scanner->newline = 0;
+    scanner->quote_carry = 0;
+    scanner->masks = csv_masks_fn();
+    if (size > 0) csv_scan_block(scanner);
+}
+
+// 取下一个结构字符，pos返回偏移，返回值为该字符（','或'\n'），到末尾返回0
+static inline char csv_scan_next(CsvScanner *scanner, size_t *pos) {
+    for (;;) {
+        uint64_t bits = scanner->comma | scanner->newline;
+        if (bits) {
+            uint64_t low = bits & (~bits + 1);
+            *pos = scanner->block + (size_t)__builtin_ctzll(bits);
+            char c = (scanner->newline & low) ? '\n' : ',';
+            scanner->comma &= ~low;
+            scanner->newline &= ~low;
+            return c;
+        }
+        if (scanner->block + 64 >= scanner->size) return 0;
+        scanner->block += 64;
+        csv_scan_block(scanner);
+    }
+}
+
+#endif
@@ -1,97 +1,240 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include "CsvMap.h"
+#include "OutWriter.h"
+#include "ThreadPool.h"
+#include "Bench.h"
 
-#define MAX_LINE_LEN 1024  // 每行最大长度
-#define COPY_TIMES 25      // 复制次数（25次）
-#define PREFIX_LEN 3       // 前缀长度（如 "01-" 含2位数字+1个短横线）
+#define COPY_TIMES 25      // 默认复制次数（25次），可用 -n 指定，如100、1000
+#define PREFIX_MAX 16      // 前缀最大长度（如 "01-"：至少2位数字+1个短横线）
 
-// 读取原始CSV并生成扩充数据
-int expand_csv(const char *input_path, const char *output_path) {
-    // 打开原始文件
-    FILE *infile = fopen(input_path, "r");
-    if (!infile) {
+// 扩充数据：表头写一次，之后把原始数据行复制COPY_TIMES份，每份的第一列前加上序号前缀（01-、02-……）。
+// 原始文件只映射、扫描一次，记下每行的位置；每份的长度都相同，所以每份在输出文件中的偏移可以事先算出。
+// 输出文件先按总长度预分配（fallocate），再分成若干段连续的份数交给线程池，
+// 各任务用定位写入器（OutWriter.h的out_attach_at，pwrite）并发写各自的区域。
+
+// 一行原始数据（含行尾换行符）
+typedef struct {
+    size_t offset;
+    size_t len;
+    int prefixed;  // 有逗号的行加前缀；无分隔符的行视为无效行，原样写入
+} SourceLine;
+
+typedef struct {
+    const char *data;
+    SourceLine *lines;
+    int line_count;
+    int width;            // 序号位数
+    size_t prefix_len;    // 前缀长度（序号位数+1）
+} EnlargeSource;
+
+typedef struct {
+    const EnlargeSource *source;
+    int fd;
+    uint64_t offset;      // 第first份在输出文件中的偏移
+    int first, last;      // 写第first..last份（从1开始）
+    int error;            // 失败时的errno
+} EnlargeTask;
+
+// 写第first..last份数据
+static void emit_copies(OutWriter *out, const EnlargeSource *source, int first, int last) {
+    char prefix[PREFIX_MAX + 1];
+    for (int i = first; i <= last; i++) {
+        snprintf(prefix, sizeof(prefix), "%0*d-", source->width, i);  // %02d 确保至少两位数字（01, 02...）
+        for (int l = 0; l < source->line_count; l++) {
+            const SourceLine *line = &source->lines[l];
+            if (line->prefixed) out_write(out, prefix, source->prefix_len);
+            out_write(out, source->data + line->offset, line->len);
+        }
+    }
+}
+
+static void enlarge_task(void *arg) {
+    EnlargeTask *task = (EnlargeTask*)arg;
+    OutWriter out;
+    if (out_attach_at(&out, task->fd, task->offset) != 0) {
+        task->error = errno;
+        return;
+    }
+    emit_copies(&out, task->source, task->first, task->last);
+    if (out_close(&out) != 0) task->error = errno;
+}
+
+// 记下表头之后各行的位置（空行跳过），返回每份数据的长度；内存不足返回-1
+static long long scan_source(EnlargeSource *source, const CsvFile *input, size_t data_start) {
+    const char *data = input->data;
+    size_t size = input->size;
+    int cap = csv_count_lines(input);
+    long long copy_size = 0;
+    source->data = data;
+    source->line_count = 0;
+    source->lines = (SourceLine*)malloc((cap > 0 ? cap : 1) * sizeof(SourceLine));
+    if (!source->lines) return -1;
+
+    for (size_t pos = data_start; pos < size;) {
+        const char *nl = (const char*)memchr(data + pos, '\n', size - pos);
+        size_t end = nl ? (size_t)(nl - data) + 1 : size;
+        // 处理空行（跳过）
+        if (data[pos] != '\n' && data[pos] != '\r') {
+            SourceLine *line = &source->lines[source->line_count++];
+            line->offset = pos;
+            line->len = end - pos;
+            line->prefixed = memchr(data + pos, ',', end - pos) != NULL;
+            copy_size += line->len + (line->prefixed ? source->prefix_len : 0);
+        }
+        pos = end;
+    }
+    return copy_size;
+}
+
+// 读取原始CSV并生成扩充数据。output_path为"-"时写到标准输出（是管道时用vmsplice，按顺序写）
+int expand_csv(const char *input_path, const char *output_path, int copy_times) {
+    CsvFile input;
+    if (csv_open(&input, input_path) != 0) {
         fprintf(stderr, "无法打开原始文件 %s：%s\n", input_path, strerror(errno));
         return -1;
     }
-
-    // 打开输出文件
-    FILE *outfile = fopen(output_path, "w");
-    if (!outfile) {
-        fprintf(stderr, "无法创建输出文件 %s：%s\n", output_path, strerror(errno));
-        fclose(infile);
+    // 表头（含换行符）仅写一次
+    const char *nl = (const char*)memchr(input.data, '\n', input.size);
+    if (!nl) {
+        fprintf(stderr, "原始文件为空或读取表头失败\n");
+        csv_close(&input);
         return -1;
     }
+    size_t header_len = (size_t)(nl - input.data) + 1;
 
-    char line[MAX_LINE_LEN];
-    // 读取并写入表头（仅写一次）
-    if (fgets(line, MAX_LINE_LEN, infile) == NULL) {
-        fprintf(stderr, "原始文件为空或读取表头失败\n");
-        fclose(infile);
-        fclose(outfile);
+    EnlargeSource source;
+    source.width = 2;
+    for (int n = copy_times; n >= 100; n /= 10) source.width++;
+    source.prefix_len = (size_t)source.width + 1;
+    long long copy_size = scan_source(&source, &input, header_len);
+    if (copy_size < 0) {
+        fprintf(stderr, "内存不足\n");
+        csv_close(&input);
         return -1;
     }
-    fputs(line, outfile);  // 写入表头
-
-    // 循环复制30次数据，每次添加不同前缀
-    for (int i = 1; i <= COPY_TIMES; i++) {
-        // 生成前缀（01- 到 30-）
-        char prefix[PREFIX_LEN + 1];  // 包含结束符 '\0'
-        snprintf(prefix, PREFIX_LEN + 1, "%02d-", i);  // %02d 确保两位数字（01, 02...30）
-
-        // 重置文件指针到数据行开头（跳过表头）
-        rewind(infile);
-        fgets(line, MAX_LINE_LEN, infile);  // 跳过表头（已写入输出文件）
-
-        // 读取原始数据行并添加前缀
-        while (fgets(line, MAX_LINE_LEN, infile)) {
-            // 处理空行（跳过）
-            if (line[0] == '\n' || line[0] == '\r') continue;
-
-            // 查找第一列分隔符（假设用逗号分隔）
-            char *first_comma = strchr(line, ',');
-            if (!first_comma) {
-                // 无分隔符，视为无效行，直接写入（不添加前缀）
-                fputs(line, outfile);
-                continue;
+    // 最后一行没有换行符时不能直接接下一份，补一个
+    SourceLine *last_line = source.line_count > 0 ? &source.lines[source.line_count - 1] : NULL;
+    char *padded = NULL;
+    if (last_line && input.data[last_line->offset + last_line->len - 1] != '\n') {
+        padded = (char*)malloc(input.size + 1);
+        if (!padded) {
+            fprintf(stderr, "内存不足\n");
+            free(source.lines);
+            csv_close(&input);
+            return -1;
+        }
+        memcpy(padded, input.data, input.size);
+        padded[input.size] = '\n';
+        source.data = padded;
+        last_line->len++;
+        copy_size++;
+    }
+    uint64_t total_size = header_len + (uint64_t)copy_size * copy_times;
+
+    int result = 0;
+    OutWriter out;
+    if (strcmp(output_path, "-") == 0) {
+        if (out_attach(&out, STDOUT_FILENO, 0, OUT_SPLICE) != 0) {
+            result = -1;
+        } else {
+            out_write(&out, input.data, header_len);
+            emit_copies(&out, &source, 1, copy_times);
+            if (out_close(&out) != 0) result = -1;
+        }
+        if (result != 0) fprintf(stderr, "写入标准输出失败：%s\n", strerror(errno));
+    } else {
+        int fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "无法创建输出文件 %s：%s\n", output_path, strerror(errno));
+            result = -1;
+        } else {
+            out_preallocate(fd, total_size);
+            if (out_attach_at(&out, fd, 0) == 0) {
+                out_write(&out, input.data, header_len);  // 写入表头
+                if (out_close(&out) != 0) result = -1;
+            } else {
+                result = -1;
             }
 
-            // 计算第一列长度和剩余内容长度
-            int first_col_len = first_comma - line;
-            int rest_len = strlen(first_comma);  // 包含逗号和后续内容
-
-            // 拼接前缀 + 第一列 + 剩余内容
-            char new_line[MAX_LINE_LEN + PREFIX_LEN];  // 预留前缀空间
-            // 复制前缀
-            strncpy(new_line, prefix, PREFIX_LEN);
-            // 复制第一列
-            strncpy(new_line + PREFIX_LEN, line, first_col_len);
-            // 复制剩余内容（逗号及之后）
-            strncpy(new_line + PREFIX_LEN + first_col_len, first_comma, rest_len + 1);  // +1 包含结束符
-
-            // 写入新行
-            fputs(new_line, outfile);
+            // 份数按CPU核数分成连续的几段，每段一个任务
+            ThreadPool *pool = thread_pool_shared();
+            int task_count = thread_pool_cpu_count();
+            if (task_count > copy_times) task_count = copy_times;
+            EnlargeTask *tasks = (EnlargeTask*)calloc(task_count, sizeof(EnlargeTask));
+            if (!tasks) {
+                errno = ENOMEM;
+                result = -1;
+            }
+            TaskGroup group = {0};
+            for (int t = 0; result == 0 && t < task_count; t++) {
+                EnlargeTask *task = &tasks[t];
+                task->source = &source;
+                task->fd = fd;
+                task->first = (int)((long long)copy_times * t / task_count) + 1;
+                task->last = (int)((long long)copy_times * (t + 1) / task_count);
+                task->offset = header_len + (uint64_t)copy_size * (task->first - 1);
+                if (pool) {
+                    thread_pool_submit(pool, &group, enlarge_task, task);
+                } else {
+                    enlarge_task(task);
+                }
+            }
+            if (pool) task_group_wait(pool, &group);
+            for (int t = 0; result == 0 && t < task_count; t++) {
+                if (tasks[t].error) {
+                    errno = tasks[t].error;
+                    result = -1;
+                }
+            }
+            free(tasks);
+            if (result != 0) fprintf(stderr, "写入输出文件 %s 失败：%s\n", output_path, strerror(errno));
+            if (close(fd) != 0 && result == 0) {
+                fprintf(stderr, "写入输出文件 %s 失败：%s\n", output_path, strerror(errno));
+                result = -1;
+            }
         }
     }
 
-    // 清理资源
-    fclose(infile);
-    fclose(outfile);
-    printf("数据扩充完成！输出文件：%s\n", output_path);
-    return 0;
+    free(padded);
+    free(source.lines);
+    csv_close(&input);
+    return result;
 }
 
-int main() {
+// 用法：Enlarge_parts [-n 复制次数] [输出路径|-]
+//   -  写到标准输出，例如 Enlarge_parts - | gzip > expanded_parts.csv.gz
+int main(int argc, char *argv[]) {
     // 原始CSV路径和输出路径（根据实际情况修改）
     const char *input_csv = "D:\\SQLlab\\lego\\data\\parts.csv";       // 原始文件
     const char *output_csv = "D:\\SQLlab\\lego\\data\\expanded_parts.csv";  // 扩充后文件
+    int copy_times = COPY_TIMES;
 
-    // 执行扩充
-    if (expand_csv(input_csv, output_csv) != 0) {
-        printf("数据扩充失败\n");
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            copy_times = atoi(argv[++i]);
+        } else {
+            output_csv = argv[i];
+        }
+    }
+    if (copy_times < 1 || copy_times > 99999999) {
+        printf("复制次数须在1到99999999之间\n");
         return 1;
     }
 
+    // 执行扩充
+    int to_stdout = strcmp(output_csv, "-") == 0;
+    double start = bench_now();
+    if (expand_csv(input_csv, output_csv, copy_times) != 0) {
+        fprintf(stderr, "数据扩充失败\n");
+        return 1;
+    }
+    if (!to_stdout) {
+        printf("数据扩充完成！输出文件：%s | 复制次数：%d | 耗时：%.4f 秒\n",
+               output_csv, copy_times, bench_now() - start);
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,378 @@
+#ifndef FILE_COMPARE_H
+#define FILE_COMPARE_H
+
+// CompareU（比较parts_copy*.csv）和CompareRS（比较spare_parts*.txt）共用的比较引擎，
+// 两个程序只是输入文件、文件个数和报告路径不同，由CompareConfig给出。
+// 比较分两步，都在线程池上按文件并发执行：
+// 先流式计算每个文件的多重集摘要（RecordDigest.h），内存占用固定；
+// 摘要和基准文件不同的文件，再载入记录集合（RecordSet.h）与只读的基准集合逐条比较，
+// 统计缺少、额外和重复次数不同的记录，每类最多保留COMPARE_REPORT_LIMIT条写入报告
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/stat.h>
+#include "RecordSet.h"
+#include "RecordDigest.h"
+#include "ThreadPool.h"
+#include "Bench.h"
+
+#define COMPARE_MAX_LINE 1024           // 每行最大长度
+#define COMPARE_MAX_FILES BENCH_MAX_INPUTS  // 最多比较的文件数量（每个文件都登记为基准输入）
+#define COMPARE_STREAM_BUFFER (1 << 20) // 读文件时的缓冲区大小
+#define COMPARE_REPORT_LIMIT 10         // 每个文件每类差异最多列出的记录数
+
+typedef struct {
+    const char* name;          // 程序名，写进基准统计
+    int file_count;            // 要比较的文件数量，第一个是基准文件
+    const char* input_format;  // 文件名格式，含一个%d
+    int input_first;           // 第一个文件的编号
+    const char* report_path;   // 详细比较报告
+} CompareConfig;
+
+// 第index个要比较的文件名
+static inline void compare_input_path(const CompareConfig* config, int index, char* path, size_t size) {
+    snprintf(path, size, config->input_format, config->input_first + index);
+}
+
+typedef void (*RecordFn)(const char* record, size_t len, void* ctx);
+
+// 向集合插入记录（去重）
+static inline void insert_record(RecordSet* set, const char* record, size_t len) {
+    if (!record || len == 0) return;
+    if (record_set_insert(set, record, len) < 0) {
+        perror("记录内存分配失败");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// 从集合查找记录
+static inline int find_record(const RecordSet* set, const char* record, size_t len) {
+    if (!record || len == 0) return 0;
+    return record_set_contains(set, record, len);
+}
+
+// 逐行读取文件中的有效数据记录（忽略表头、空行和统计行），每条记录调用一次fn。
+// 打开失败返回-1，否则返回0
+static inline int scan_records(const char* filename, RecordFn fn, void* ctx) {
+    FILE* file = fopen(filename, "r");
+    if (!file) {
+        perror("无法打开文件");
+        return -1;
+    }
+    setvbuf(file, NULL, _IOFBF, COMPARE_STREAM_BUFFER);
+
+    char line[COMPARE_MAX_LINE];
+    int is_header = 1; // 标记表头行
+
+    while (fgets(line, COMPARE_MAX_LINE, file)) {
+        // 处理换行符和首尾空白
+        line[strcspn(line, "\r\n")] = '\0';
+        int len = strlen(line);
+        while (len > 0 && isspace((unsigned char)line[len - 1])) {
+            len--;
+        }
+        line[len] = '\0';
+
+        // 忽略空行
+        if (len == 0) continue;
+
+        // 忽略表头行（第一行）
+        if (is_header) {
+            is_header = 0;
+            continue;
+        }
+
+        // 忽略统计行（含"总计："或分隔线）
+        if (strstr(line, "总计：") != NULL || strstr(line, "---") != NULL) {
+            continue;
+        }
+
+        fn(line, (size_t)len, ctx);
+    }
+
+    fclose(file);
+    return 0;
+}
+
+static void insert_record_fn(const char* record, size_t len, void* ctx) {
+    insert_record((RecordSet*)ctx, record, len);
+}
+
+static void digest_record_fn(const char* record, size_t len, void* ctx) {
+    record_digest_add((RecordDigest*)ctx, record, len);
+}
+
+// 读取文件中的有效数据记录，存储到记录集合（去重），返回记录数，打开失败返回-1
+static inline int load_records(const char* filename, RecordSet* set) {
+    // 按文件大小估算容量（正文不超过文件大小，每行按32字节估计条数），加载中途一般不用扩容
+    struct stat st;
+    size_t expected_bytes = (stat(filename, &st) == 0) ? (size_t)st.st_size : 0;
+    record_set_clear(set);
+    if (record_set_reserve(set, expected_bytes / 32, expected_bytes) != 0) {
+        perror("记录内存分配失败");
+        return -1;
+    }
+    if (scan_records(filename, insert_record_fn, set) != 0) return -1;
+    return (int)set->count;
+}
+
+// 流式计算文件的多重集摘要，返回记录条数（含重复），打开失败返回-1
+static inline long digest_records(const char* filename, RecordDigest* digest) {
+    record_digest_init(digest);
+    if (scan_records(filename, digest_record_fn, digest) != 0) return -1;
+    return (long)digest->count;
+}
+
+// 差异类别
+typedef enum {
+    DIFF_MISSING,    // 基准文件有、当前文件没有
+    DIFF_EXTRA,      // 当前文件有、基准文件没有
+    DIFF_DUPLICATE,  // 两边都有，但出现次数不同
+    DIFF_KINDS
+} DiffKind;
+
+typedef struct {
+    char record[COMPARE_MAX_LINE];
+    uint32_t base_count, curr_count;
+} DiffSample;
+
+// 单个文件的比较结果
+typedef struct {
+    char filename[64];
+    const RecordSet* base_set;  // 共享的只读基准集合
+    RecordDigest digest;
+    long count;                 // 记录条数（含重复），读取失败为-1
+    int same;
+    long diff_total[DIFF_KINDS];
+    int sample_count[DIFF_KINDS];
+    DiffSample samples[DIFF_KINDS][COMPARE_REPORT_LIMIT];
+} FileReport;
+
+static inline void add_difference(FileReport* report, DiffKind kind, const char* record, size_t len,
+                           uint32_t base_count, uint32_t curr_count) {
+    report->diff_total[kind]++;
+    if (report->sample_count[kind] >= COMPARE_REPORT_LIMIT) return;
+    DiffSample* sample = &report->samples[kind][report->sample_count[kind]++];
+    memcpy(sample->record, record, len + 1);
+    sample->base_count = base_count;
+    sample->curr_count = curr_count;
+}
+
+static void digest_task(void* arg) {
+    FileReport* report = (FileReport*)arg;
+    report->count = digest_records(report->filename, &report->digest);
+}
+
+// 载入当前文件，与基准集合双向逐条比较
+static void diff_task(void* arg) {
+    FileReport* report = (FileReport*)arg;
+    const RecordSet* base_set = report->base_set;
+    RecordSet curr_set = {0};
+    if (load_records(report->filename, &curr_set) <= 0) {
+        report->count = -1;
+        record_set_free(&curr_set);
+        return;
+    }
+
+    // 按条目顺序遍历，次数直接取自条目，每条记录只在对方集合里查一次
+    for (uint32_t e = 0; e < curr_set.count; e++) {
+        size_t len;
+        const char* record = record_set_key(&curr_set, e, &len);
+        uint32_t curr_count = curr_set.entries[e].count;
+        uint32_t base_count = record_set_count(base_set, record, len);
+        if (base_count == 0) {
+            add_difference(report, DIFF_EXTRA, record, len, 0, curr_count);
+        } else if (base_count != curr_count) {
+            add_difference(report, DIFF_DUPLICATE, record, len, base_count, curr_count);
+        }
+    }
+    for (uint32_t e = 0; e < base_set->count; e++) {
+        size_t len;
+        const char* record = record_set_key(base_set, e, &len);
+        if (!find_record(&curr_set, record, len)) {
+            add_difference(report, DIFF_MISSING, record, len, base_set->entries[e].count, 0);
+        }
+    }
+    record_set_free(&curr_set);
+}
+
+// 在线程池上并发执行，线程池不可用时直接在当前线程执行
+static inline void run_tasks(TaskFn fn, FileReport* reports, const int* which, int count) {
+    ThreadPool* pool = thread_pool_shared();
+    TaskGroup group = {0};
+    for (int i = 0; i < count; i++) {
+        if (pool) {
+            thread_pool_submit(pool, &group, fn, &reports[which[i]]);
+        } else {
+            fn(&reports[which[i]]);
+        }
+    }
+    if (pool) task_group_wait(pool, &group);
+}
+
+// 输出JSON字符串（转义引号、反斜杠和控制字符）
+static inline void write_json_string(FILE* out, const char* str) {
+    fputc('"', out);
+    for (const unsigned char* p = (const unsigned char*)str; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(out, "\\%c", *p);
+        } else if (*p < 0x20) {
+            fprintf(out, "\\u%04x", *p);
+        } else {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
+
+// 写出详细报告：每个文件一项，列出状态、条数、各类差异的总数和前COMPARE_REPORT_LIMIT条样例
+static inline int write_report(const char* path, const FileReport* reports, int count) {
+    static const char* kind_names[DIFF_KINDS] = { "missing", "extra", "duplicate" };
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        perror("无法创建比较报告");
+        return -1;
+    }
+    fprintf(out, "{\n  \"base\": ");
+    write_json_string(out, reports[0].filename);
+    fprintf(out, ",\n  \"base_count\": %ld,\n  \"limit\": %d,\n  \"files\": [", reports[0].count, COMPARE_REPORT_LIMIT);
+    for (int i = 1; i < count; i++) {
+        const FileReport* report = &reports[i];
+        const char* status = report->count <= 0 ? "unreadable" : (report->same ? "same" : "different");
+        fprintf(out, "%s\n    {\"file\": ", i > 1 ? "," : "");
+        write_json_string(out, report->filename);
+        fprintf(out, ", \"status\": \"%s\", \"count\": %ld", status, report->count);
+        for (int k = 0; k < DIFF_KINDS; k++) {
+            fprintf(out, ", \"%s\": %ld", kind_names[k], report->diff_total[k]);
+        }
+        for (int k = 0; k < DIFF_KINDS; k++) {
+            fprintf(out, ",\n     \"%s_samples\": [", kind_names[k]);
+            for (int j = 0; j < report->sample_count[k]; j++) {
+                const DiffSample* sample = &report->samples[k][j];
+                fprintf(out, "%s{\"record\": ", j > 0 ? ", " : "");
+                write_json_string(out, sample->record);
+                fprintf(out, ", \"base\": %u, \"file\": %u}", sample->base_count, sample->curr_count);
+            }
+            fprintf(out, "]");
+        }
+        fprintf(out, "}");
+    }
+    fprintf(out, "\n  ]\n}\n");
+    fclose(out);
+    return 0;
+}
+
+// 比较所有文件的有效数据记录是否相同（忽略顺序，重复记录的次数也要相同）
+// 计时阶段（Bench.h）：digest为并发计算摘要，diff为载入基准集合并逐条比较，output为输出结论和报告，free为释放
+static inline int compare_files(const CompareConfig* config, Bench* bench) {
+    int file_count = config->file_count;
+    FileReport* reports = (FileReport*)calloc(file_count, sizeof(FileReport));
+    if (!reports) {
+        perror("比较结果内存分配失败");
+        return -1;
+    }
+
+    // 生成文件名（如spare_parts10.txt起的file_count个）
+    int all_files[COMPARE_MAX_FILES];
+    for (int i = 0; i < file_count; i++) {
+        compare_input_path(config, i, reports[i].filename, sizeof(reports[i].filename));
+        all_files[i] = i;
+    }
+
+    // 第一步：所有文件（含基准文件）并发计算摘要
+    bench_phase(bench, "digest");
+    run_tasks(digest_task, reports, all_files, file_count);
+
+    // 第一个文件作为基准
+    long base_count = reports[0].count;
+    if (base_count <= 0) {
+        printf("基准文件 %s 中未读取到有效记录\n", reports[0].filename);
+        free(reports);
+        return -1;
+    }
+    printf("基准文件 %s 读取完成，有效记录数：%ld\n", reports[0].filename, base_count);
+
+    // 第二步：摘要不同的文件与共享的基准集合并发逐条比较
+    bench_phase(bench, "diff");
+    int diff_files[COMPARE_MAX_FILES];
+    int diff_count = 0;
+    for (int i = 1; i < file_count; i++) {
+        reports[i].same = reports[i].count > 0 && record_digest_equal(&reports[i].digest, &reports[0].digest);
+        if (reports[i].count > 0 && !reports[i].same) diff_files[diff_count++] = i;
+    }
+    RecordSet base_set = {0};
+    if (diff_count > 0) {
+        if (load_records(reports[0].filename, &base_set) <= 0) {
+            printf("基准文件 %s 重新读取失败\n", reports[0].filename);
+            record_set_free(&base_set);
+            free(reports);
+            return -1;
+        }
+        for (int i = 0; i < diff_count; i++) reports[diff_files[i]].base_set = &base_set;
+        run_tasks(diff_task, reports, diff_files, diff_count);
+    }
+
+    // 按文件顺序输出每个文件的结论
+    bench_phase(bench, "output");
+    int all_same = 1;
+    for (int i = 1; i < file_count; i++) {
+        const FileReport* report = &reports[i];
+        if (report->count <= 0) {
+            printf("文件 %s 中未读取到有效记录\n", report->filename);
+            all_same = 0;
+        } else if (report->same) {
+            printf("文件 %s 与基准文件记录集合一致（%ld 条记录）\n", report->filename, report->count);
+        } else {
+            printf("文件 %s 与基准文件不一致：缺少 %ld 条，额外 %ld 条，重复次数不同 %ld 条（记录数 %ld vs %ld）\n",
+                   report->filename, report->diff_total[DIFF_MISSING], report->diff_total[DIFF_EXTRA],
+                   report->diff_total[DIFF_DUPLICATE], report->count, base_count);
+            all_same = 0;
+        }
+    }
+
+    // 输出最终结果
+    if (all_same) {
+        printf("\n所有文件的有效数据记录集合完全相同（忽略顺序）\n");
+    } else {
+        printf("\n文件记录集合存在差异\n");
+    }
+    if (write_report(config->report_path, reports, file_count) == 0) {
+        printf("详细比较报告：%s\n", config->report_path);
+    }
+
+    // 清理资源
+    bench_phase(bench, "free");
+    record_set_free(&base_set);
+    free(reports);
+    return all_same ? 0 : 1;
+}
+
+// 程序入口：解析基准参数，按--runs重复比较。返回值作为进程退出码：全部一致为0
+static inline int compare_main(const CompareConfig* config, int argc, char* argv[]) {
+    Bench bench;
+    int result = 1;
+    char inputs[COMPARE_MAX_FILES][64];
+    if (config->file_count < 1 || config->file_count > COMPARE_MAX_FILES) {
+        printf("要比较的文件数量必须在1到%d之间\n", COMPARE_MAX_FILES);
+        return 1;
+    }
+    bench_init(&bench, config->name, 1, 0);
+    for (int i = 0; i < config->file_count; i++) {
+        compare_input_path(config, i, inputs[i], sizeof(inputs[i]));
+        bench_input(&bench, inputs[i]);
+    }
+    if (bench_parse_args(&bench, &argc, argv) != 0) return 1;
+
+    while (bench_next_run(&bench)) {
+        result = compare_files(config, &bench);
+        double time = bench_run_end(&bench, result >= 0);
+        printf("\n比较完成，耗时：%.2f 毫秒\n", time * 1000);
+    }
+    if (bench.runs > 1 || bench.csv_path || bench.json_path || bench.perf_enabled) bench_report(&bench);
+    bench_free(&bench);
+    return result;
+}
+
+#endif
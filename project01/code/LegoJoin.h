@@ -0,0 +1,445 @@
+#ifndef LEGO_JOIN_H
+#define LEGO_JOIN_H
+
+// 多表关联查询（RetrievalMultiple的Castle/Black查询）、inventory_parts的条件过滤和五张表的并发读取，
+// 由RetrievalMultiple.c（每次查询都重新读表）、QueryServer.c（表只读一次、常驻内存）和LoadBench.c（并发压测）共用。
+// 各表的列存结构见LegoTables.h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "LegoTables.h"
+#include "SortPerm.h"
+#include "RecordSet.h"
+#include "ThreadPool.h"
+#include "Bench.h"
+
+// 结果集结构：字符串字段存全局字典编码，打印时才取正文
+typedef struct {
+    StrCode set_num;
+    StrCode set_name;
+    int publish_year;
+    StrCode theme_name;
+    StrCode part_id;
+    int inventory_quantity;
+} Result;
+
+// 哈希索引：buckets存每个桶的首行下标，next把同一个桶里的行串成链（-1表示结束）
+// 只存下标不存数据，建在哪张表上就按哪张表的下标解释
+typedef struct {
+    int *buckets;
+    int *next;
+    unsigned int mask;  // 桶数-1（桶数取2的幂）
+} JoinIndex;
+
+static inline unsigned int hashInt(int key) {
+    unsigned int h = (unsigned int)key * 2654435761u;  // 乘法散列
+    return h ^ (h >> 16);
+}
+
+// 按行数从arena分配索引（负载因子不超过0.5），失败返回0
+static inline int initJoinIndex(JoinIndex *idx, int rowCount, Arena *arena) {
+    unsigned int bucketCount = 16;
+    while (bucketCount < (unsigned int)rowCount * 2) bucketCount <<= 1;
+    idx->mask = bucketCount - 1;
+    idx->buckets = (int*)arena_alloc(arena, bucketCount * sizeof(int));
+    idx->next = (int*)arena_alloc(arena, (rowCount > 0 ? rowCount : 1) * sizeof(int));
+    if (!idx->buckets || !idx->next) {
+        idx->buckets = idx->next = NULL;
+        return 0;
+    }
+    memset(idx->buckets, -1, bucketCount * sizeof(int));
+    return 1;
+}
+
+// 头插法：调用方按行号倒序插入，链上的顺序就和原表顺序一致
+static inline void joinIndexInsert(JoinIndex *idx, unsigned int h, int row) {
+    unsigned int b = h & idx->mask;
+    idx->next[row] = idx->buckets[b];
+    idx->buckets[b] = row;
+}
+
+// 查询参数：原查询是 Castle主题、Black颜色、2000~2020年发布、零件数量不少于5，
+// 查询服务（QueryServer.c）允许客户端换成别的取值
+typedef struct {
+    const char *themeName;  // 主题名称
+    const char *colorName;  // 颜色名称
+    int yearFrom, yearTo;   // 发布年份范围（含两端）
+    int minQuantity;        // 零件数量下限
+    int limit;              // 只要按数量排序后的前limit条（LIMIT n），0表示全部
+} JoinQuery;
+
+#define JOIN_QUERY_DEFAULT { "Castle", "Black", 2000, 2020, 5, 0 }
+
+// 关联查询的中间状态：各阶段只依赖自己需要的表，
+// 因此可以在其他表还在读取时先把已就绪的表建成索引。
+// 索引、候选集和结果集都从arena分配，查询结束时随arena一起释放
+typedef struct {
+    Arena *arena;
+    JoinIndex colorIdx;   // 指定颜色，按id
+    JoinIndex themeIdx;   // 指定主题，按id
+    JoinIndex candIdx;    // 候选库存，按inventory id
+    int *candSet, *candTheme, *candInv;  // 候选(set, theme, inventory)三元组
+    int candCount;
+    JoinQuery query;
+    int failed;
+    Bench *bench;         // 非NULL时探测和排序分阶段计时
+} JoinState;
+
+// 阶段1a：指定颜色按id建索引
+static inline void joinBuildColors(JoinState *state, const ColorTable *colors) {
+    if (!initJoinIndex(&state->colorIdx, colors->count, state->arena)) {
+        printf("哈希索引内存分配失败\n");
+        state->failed = 1;
+        return;
+    }
+    StrCode color = str_dict_find(state->query.colorName);
+    for (int c = colors->count - 1; c >= 0; c--) {
+        if (colors->name[c] == color) {
+            joinIndexInsert(&state->colorIdx, hashInt(colors->id[c]), c);
+        }
+    }
+}
+
+// 阶段1b：指定主题按id建索引
+static inline void joinBuildThemes(JoinState *state, const ThemeTable *themes) {
+    if (!initJoinIndex(&state->themeIdx, themes->count, state->arena)) {
+        printf("哈希索引内存分配失败\n");
+        state->failed = 1;
+        return;
+    }
+    StrCode theme = str_dict_find(state->query.themeName);
+    for (int t = themes->count - 1; t >= 0; t--) {
+        if (themes->name[t] == theme) {
+            joinIndexInsert(&state->themeIdx, hashInt(themes->id[t]), t);
+        }
+    }
+}
+
+// 库存按set_num分组：RecordSet给每个不同的set_num一个组号，
+// groupFirst[组号]是组内首行，invNext把同组的行按原表顺序串起来（-1表示结束）。
+// 探测时每个set只查一次集合，链上全是命中的行，不用再逐行比较键
+static inline int groupInventoriesBySet(const InventoryTable *inventories, RecordSet *groups,
+                                 int **groupFirst, int **invNext, Arena *arena) {
+    int count = inventories->count;
+    int *groupOf = (int*)arena_alloc(arena, (count > 0 ? count : 1) * sizeof(int));
+    *invNext = (int*)arena_alloc(arena, (count > 0 ? count : 1) * sizeof(int));
+    if (!groupOf || !*invNext) return 0;
+    if (record_set_reserve(groups, count, (size_t)count * (sizeof(StrCode) + 1)) != 0) return 0;
+    for (int i = 0; i < count; i++) {
+        uint32_t g = record_set_add(groups, (const char*)&inventories->set_num[i], sizeof(StrCode), NULL);
+        if (g == RECORD_NONE) return 0;
+        groupOf[i] = (int)g;
+    }
+    *groupFirst = (int*)arena_alloc(arena, (groups->count > 0 ? groups->count : 1) * sizeof(int));
+    if (!*groupFirst) return 0;
+    memset(*groupFirst, -1, (groups->count > 0 ? groups->count : 1) * sizeof(int));
+    for (int i = count - 1; i >= 0; i--) {
+        (*invNext)[i] = (*groupFirst)[groupOf[i]];
+        (*groupFirst)[groupOf[i]] = i;
+    }
+    return 1;
+}
+
+// 阶段2：库存按set_num分组，由sets驱动探测主题和库存，
+// 得到候选库存列表（顺序即原循环顺序），再按inventory id建索引。需要阶段1b已完成
+static inline void joinBuildCandidates(JoinState *state, const SetTable *sets, const ThemeTable *themes,
+                         const InventoryTable *inventories) {
+    RecordSet setGroups = {0};
+    int *groupFirst = NULL, *invNext = NULL;
+    int candCapacity = 100;
+    if (state->failed) return;
+
+    Arena *arena = state->arena;
+    state->candSet = (int*)arena_alloc(arena, candCapacity * sizeof(int));
+    state->candTheme = (int*)arena_alloc(arena, candCapacity * sizeof(int));
+    state->candInv = (int*)arena_alloc(arena, candCapacity * sizeof(int));
+    if (!state->candSet || !state->candTheme || !state->candInv ||
+        !groupInventoriesBySet(inventories, &setGroups, &groupFirst, &invNext, arena)) {
+        printf("候选集内存分配失败\n");
+        record_set_free(&setGroups);
+        state->failed = 1;
+        return;
+    }
+
+    JoinIndex *themeIdx = &state->themeIdx;
+    for (int s = 0; s < sets->count; s++) {
+        if (sets->year[s] < state->query.yearFrom || sets->year[s] > state->query.yearTo) continue;
+
+        int themeId = sets->theme_id[s];
+        for (int t = themeIdx->buckets[hashInt(themeId) & themeIdx->mask]; t >= 0; t = themeIdx->next[t]) {
+            if (themes->id[t] != themeId) continue;
+
+            uint32_t g = record_set_lookup(&setGroups, (const char*)&sets->set_num[s], sizeof(StrCode));
+            if (g == RECORD_NONE) continue;
+            for (int i = groupFirst[g]; i >= 0; i = invNext[i]) {
+                if (state->candCount >= candCapacity) {
+                    size_t oldSize = candCapacity * sizeof(int);
+                    candCapacity *= 2;
+                    int *ts = (int*)arena_grow(arena, state->candSet, oldSize, candCapacity * sizeof(int));
+                    if (ts) state->candSet = ts;
+                    int *tt = (int*)arena_grow(arena, state->candTheme, oldSize, candCapacity * sizeof(int));
+                    if (tt) state->candTheme = tt;
+                    int *ti = (int*)arena_grow(arena, state->candInv, oldSize, candCapacity * sizeof(int));
+                    if (ti) state->candInv = ti;
+                    if (!ts || !tt || !ti) {
+                        printf("候选集扩展失败\n");
+                        record_set_free(&setGroups);
+                        state->failed = 1;
+                        return;
+                    }
+                }
+                state->candSet[state->candCount] = s;
+                state->candTheme[state->candCount] = t;
+                state->candInv[state->candCount] = i;
+                state->candCount++;
+            }
+        }
+    }
+    record_set_free(&setGroups);
+
+    if (!initJoinIndex(&state->candIdx, state->candCount, arena)) {
+        printf("哈希索引内存分配失败\n");
+        state->failed = 1;
+        return;
+    }
+    for (int k = state->candCount - 1; k >= 0; k--) {
+        joinIndexInsert(&state->candIdx, hashInt(inventories->id[state->candInv[k]]), k);
+    }
+}
+
+// 阶段3：顺序扫描inventory_parts探测候选库存和颜色，生成结果集。需要阶段1a和2已完成
+// 扫描只读quantity、inventory_id、color_id三列，part_num只在输出时访问
+static inline Result* joinProbeParts(JoinState *state, const SetTable *sets, const ThemeTable *themes,
+                       const InventoryTable *inventories, const InventoryPartTable *parts,
+                       const ColorTable *colors, int *resultCount) {
+    *resultCount = 0;
+    if (state->failed) return NULL;
+
+    Arena *arena = state->arena;
+    Result *results = NULL;
+    int *matchCand = NULL, *matchPart = NULL, *order = NULL, *offsets = NULL, *keys = NULL, *perm = NULL;
+    int matchCount = 0, matchCapacity = 100;
+    JoinIndex *candIdx = &state->candIdx;
+    JoinIndex *colorIdx = &state->colorIdx;
+    const int *quantity = parts->quantity;
+    const int *inventoryId = parts->inventory_id;
+    const int *colorId = parts->color_id;
+    int minQuantity = state->query.minQuantity;
+
+    matchCand = (int*)arena_alloc(arena, matchCapacity * sizeof(int));
+    matchPart = (int*)arena_alloc(arena, matchCapacity * sizeof(int));
+    if (!matchCand || !matchPart) {
+        printf("结果集内存分配失败\n");
+        return NULL;
+    }
+    for (int p = 0; p < parts->count; p++) {
+        if (quantity[p] < minQuantity) continue;
+
+        for (int k = candIdx->buckets[hashInt(inventoryId[p]) & candIdx->mask]; k >= 0; k = candIdx->next[k]) {
+            if (inventories->id[state->candInv[k]] != inventoryId[p]) continue;
+
+            for (int c = colorIdx->buckets[hashInt(colorId[p]) & colorIdx->mask]; c >= 0; c = colorIdx->next[c]) {
+                if (colors->id[c] != colorId[p]) continue;
+
+                if (matchCount >= matchCapacity) {
+                    size_t oldSize = matchCapacity * sizeof(int);
+                    matchCapacity *= 2;
+                    int *tk = (int*)arena_grow(arena, matchCand, oldSize, matchCapacity * sizeof(int));
+                    if (tk) matchCand = tk;
+                    int *tp = (int*)arena_grow(arena, matchPart, oldSize, matchCapacity * sizeof(int));
+                    if (tp) matchPart = tp;
+                    if (!tk || !tp) {
+                        printf("结果集扩展失败\n");
+                        return NULL;
+                    }
+                }
+                matchCand[matchCount] = k;
+                matchPart[matchCount] = p;
+                matchCount++;
+            }
+        }
+    }
+
+    // 按候选下标做一次稳定的计数排序，恢复成原五重循环的输出顺序
+    bench_phase(state->bench, "sort");
+    order = (int*)arena_alloc(arena, matchCount * sizeof(int));
+    offsets = (int*)arena_calloc(arena, state->candCount + 1, sizeof(int));
+    keys = (int*)arena_alloc(arena, matchCount * sizeof(int));
+    perm = (int*)arena_alloc(arena, matchCount * sizeof(int));
+    if (!order || !offsets || !keys || !perm) {
+        printf("结果集内存分配失败\n");
+        return NULL;
+    }
+    for (int m = 0; m < matchCount; m++) offsets[matchCand[m] + 1]++;
+    for (int k = 0; k < state->candCount; k++) offsets[k + 1] += offsets[k];
+    for (int m = 0; m < matchCount; m++) order[offsets[matchCand[m]]++] = m;
+
+    // 按数量降序排序：只排下标，数量相同的保持原顺序（与原来的冒泡排序结果一致）；
+    // 有LIMIT时只用堆取前limit条
+    for (int r = 0; r < matchCount; r++) keys[r] = quantity[matchPart[order[r]]];
+    int outCount = matchCount;
+    if (state->query.limit > 0 && state->query.limit < matchCount) {
+        outCount = sort_perm_topk(keys, perm, matchCount, state->query.limit, SORT_DESC, arena);
+    } else if (sort_perm(keys, perm, matchCount, SORT_DESC | SORT_STABLE, arena) != 0) {
+        outCount = -1;
+    }
+    results = (Result*)arena_alloc(arena, (outCount > 0 ? outCount : 1) * sizeof(Result));
+    if (outCount < 0 || !results) {
+        printf("结果集内存分配失败\n");
+        return NULL;
+    }
+
+    // 按排好的顺序保存结果
+    for (int r = 0; r < outCount; r++) {
+        int m = order[perm[r]];
+        int k = matchCand[m];
+        int s = state->candSet[k];
+        int p = matchPart[m];
+        results[r].set_num = sets->set_num[s];
+        results[r].set_name = sets->name[s];
+        results[r].publish_year = sets->year[s];
+        results[r].theme_name = themes->name[state->candTheme[k]];
+        results[r].part_id = parts->part_num[p];
+        results[r].inventory_quantity = quantity[p];
+    }
+    *resultCount = outCount;
+
+    return results;
+}
+
+// 多表关联查询（中间结构和结果集都从arena分配，由调用方arena_release统一释放）
+// 执行计划：在小表上建哈希索引（颜色/主题按id，库存按set_num），
+// 先由sets驱动得到符合条件的库存，再把inventory_parts顺序扫描一遍做探测。
+// 输出顺序与原来的五重循环完全一致（sets→themes→inventories→parts→colors）。
+// 只读访问各表，多个线程可以在同一组表上同时查询（各用各的arena）
+static inline Result* multiTableJoinQuery(
+    const SetTable *sets,
+    const ThemeTable *themes,
+    const InventoryTable *inventories,
+    const InventoryPartTable *parts,
+    const ColorTable *colors,
+    const JoinQuery *query,
+    Arena *arena,
+    int *resultCount  // 用于传出结果数量
+) {
+    JoinState state = {0};
+    state.arena = arena;
+    state.query = *query;
+    joinBuildColors(&state, colors);
+    joinBuildThemes(&state, themes);
+    joinBuildCandidates(&state, sets, themes, inventories);
+    return joinProbeParts(&state, sets, themes, inventories, parts, colors, resultCount);
+}
+
+// 原查询（Castle、Black、2000~2020年、数量不少于5）
+static inline Result* multiTableJoin(
+    const SetTable *sets,
+    const ThemeTable *themes,
+    const InventoryTable *inventories,
+    const InventoryPartTable *parts,
+    const ColorTable *colors,
+    int limit,        // 只返回数量最多的前limit条，0表示全部
+    Arena *arena,
+    int *resultCount  // 用于传出结果数量
+) {
+    JoinQuery query = JOIN_QUERY_DEFAULT;
+    query.limit = limit;
+    return multiTableJoinQuery(sets, themes, inventories, parts, colors, &query, arena, resultCount);
+}
+
+// 按条件过滤inventory_parts，命中的行号按原表顺序写进rows（至少parts->count个），返回命中的行数。
+// spare为-1不限、0/1按is_spare；colorId为-1不限；limit为0表示全部。空闲零件导出即spare=1、colorId=-1、minQuantity=0
+static inline int filterParts(const InventoryPartTable *parts, int spare, int colorId, int minQuantity,
+                              int limit, int *rows) {
+    int count = 0;
+    for (int i = 0; i < parts->count && (limit == 0 || count < limit); i++) {
+        if (spare >= 0 && (parts->is_spare[i] == 't') != spare) continue;
+        if (colorId >= 0 && parts->color_id[i] != colorId) continue;
+        if (parts->quantity[i] < minQuantity) continue;
+        rows[count++] = i;
+    }
+    return count;
+}
+
+#define SETS_PATH "D:\\SQLlab\\lego\\data\\sets.csv"
+#define THEMES_PATH "D:\\SQLlab\\lego\\data\\themes.csv"
+#define INVENTORIES_PATH "D:\\SQLlab\\lego\\data\\inventories.csv"
+#define INVENTORY_PARTS_PATH "D:\\SQLlab\\lego\\data\\inventory_parts.csv"
+#define COLORS_PATH "D:\\SQLlab\\lego\\data\\colors.csv"
+
+// 五张表的并发读取：每张表一个任务，各自用一个TaskGroup标记完成
+typedef struct {
+    SetTable sets;
+    ThemeTable themes;
+    InventoryTable inventories;
+    InventoryPartTable inventoryParts;
+    ColorTable colors;
+    int setsOk, themesOk, inventoriesOk, partsOk, colorsOk;
+    TaskGroup setsDone, themesDone, inventoriesDone, partsDone, colorsDone;
+} TableLoad;
+
+static void loadSetsTask(void *arg) {
+    TableLoad *load = (TableLoad*)arg;
+    load->setsOk = load_set_table(&load->sets, SETS_PATH) >= 0;
+}
+
+static void loadThemesTask(void *arg) {
+    TableLoad *load = (TableLoad*)arg;
+    load->themesOk = load_theme_table(&load->themes, THEMES_PATH) >= 0;
+}
+
+static void loadInventoriesTask(void *arg) {
+    TableLoad *load = (TableLoad*)arg;
+    load->inventoriesOk = load_inventory_table(&load->inventories, INVENTORIES_PATH) >= 0;
+}
+
+static void loadPartsTask(void *arg) {
+    TableLoad *load = (TableLoad*)arg;
+    load->partsOk = load_inventory_part_table(&load->inventoryParts, INVENTORY_PARTS_PATH) >= 0;
+}
+
+static void loadColorsTask(void *arg) {
+    TableLoad *load = (TableLoad*)arg;
+    load->colorsOk = load_color_table(&load->colors, COLORS_PATH) >= 0;
+}
+
+// 提交任务；线程池不可用时直接在当前线程执行
+static inline void submitLoad(ThreadPool *pool, TaskGroup *group, TaskFn fn, TableLoad *load) {
+    if (pool) {
+        thread_pool_submit(pool, group, fn, load);
+    } else {
+        fn(load);
+    }
+}
+
+static inline void waitLoad(ThreadPool *pool, TaskGroup *group) {
+    if (pool) task_group_wait(pool, group);
+}
+
+static inline void freeTables(TableLoad *load) {
+    free_set_table(&load->sets);
+    free_theme_table(&load->themes);
+    free_inventory_table(&load->inventories);
+    free_inventory_part_table(&load->inventoryParts);
+    free_color_table(&load->colors);
+}
+
+// 同时读取五张表并等待全部完成，成功返回0；失败返回-1（已读入的表仍需freeTables释放）
+static inline int loadTables(TableLoad *load) {
+    ThreadPool *pool = thread_pool_shared();
+    memset(load, 0, sizeof(*load));
+    submitLoad(pool, &load->partsDone, loadPartsTask, load);
+    submitLoad(pool, &load->setsDone, loadSetsTask, load);
+    submitLoad(pool, &load->inventoriesDone, loadInventoriesTask, load);
+    submitLoad(pool, &load->themesDone, loadThemesTask, load);
+    submitLoad(pool, &load->colorsDone, loadColorsTask, load);
+    waitLoad(pool, &load->partsDone);
+    waitLoad(pool, &load->setsDone);
+    waitLoad(pool, &load->inventoriesDone);
+    waitLoad(pool, &load->themesDone);
+    waitLoad(pool, &load->colorsDone);
+    return load->setsOk && load->themesOk && load->inventoriesOk && load->partsOk && load->colorsOk ? 0 : -1;
+}
+
+#endif
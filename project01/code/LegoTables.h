@@ -0,0 +1,432 @@
+#ifndef LEGO_TABLES_H
+#define LEGO_TABLES_H
+
+// LEGO各表的列存（结构数组）内存布局：每一列是一段连续数组，扫描和过滤只读用到的列。
+// 整数列在快照可用时直接指向快照的映射区（零拷贝），否则由CSV解析得到；
+// 字符串列只存全局字典（StrDict.h）的32位编码，过滤和关联比较编码，输出时再取正文。
+// 需要逐行结构体的地方可以用 xxx_row() 取出一行的兼容视图。
+
+#include "CsvParallel.h"
+#include "ColumnSnapshot.h"
+#include "StrDict.h"
+#include "Arena.h"
+
+#define TABLE_MAX_COLUMNS SNAP_MAX_COLUMNS
+
+// 内存中的列类型（快照里FLAG按字符串保存）
+typedef enum {
+    COL_INT,   // const int*
+    COL_STR,   // StrCode*，去掉外层引号后驻留到全局字典
+    COL_FLAG   // char*，字段为"t"时是't'，否则是'f'
+} ColumnKind;
+
+typedef union {
+    const int *ints;
+    StrCode *codes;
+    char *flags;
+} TableColumn;
+
+// 表的底层存储：快照的映射（整数列指向这里），以及存放本表列数组的Arena
+typedef struct {
+    SnapTable snap;
+    int has_snap;
+    CsvFile csv;
+    int has_csv;
+    Arena arena;
+} TableStore;
+
+// 兼容旧代码的逐行结构体
+typedef struct {
+    char set_num[50];
+    char name[100];
+    int year;
+    int theme_id;
+} Set;
+
+typedef struct {
+    int id;
+    char name[100];
+    int parent_id;
+} Theme;
+
+typedef struct {
+    int id;
+    int version;
+    char set_num[50];
+} Inventory;
+
+typedef struct {
+    int inventory_id;
+    char part_num[50];
+    int color_id;
+    int quantity;
+    char is_spare;
+} InventoryPart;
+
+typedef struct {
+    int id;
+    char name[50];
+    char rgb[20];
+    char is_trans[10];
+} Color;
+
+// 各表的列存结构
+typedef struct {
+    int count;
+    StrCode *set_num;
+    StrCode *name;
+    const int *year;
+    const int *theme_id;
+    TableStore store;
+} SetTable;
+
+typedef struct {
+    int count;
+    const int *id;
+    StrCode *name;
+    const int *parent_id;
+    TableStore store;
+} ThemeTable;
+
+typedef struct {
+    int count;
+    const int *id;
+    const int *version;
+    StrCode *set_num;
+    TableStore store;
+} InventoryTable;
+
+typedef struct {
+    int count;
+    const int *inventory_id;
+    StrCode *part_num;
+    const int *color_id;
+    const int *quantity;
+    char *is_spare;
+    TableStore store;
+} InventoryPartTable;
+
+typedef struct {
+    int count;
+    const int *id;
+    StrCode *name;
+    StrCode *rgb;
+    StrCode *is_trans;
+    TableStore store;
+} ColorTable;
+
+// ---------- 通用加载 ----------
+
+static inline void* table_store_alloc(TableStore *store, size_t size) {
+    return arena_alloc(&store->arena, size);
+}
+
+// 行数确定后按各列宽度一次预留好列数组的空间；ints_mapped表示整数列直接用快照映射
+static inline int table_store_reserve(TableStore *store, const ColumnKind *kinds, int column_count,
+                                      int rows, int ints_mapped) {
+    size_t bytes = 0;
+    for (int c = 0; c < column_count; c++) {
+        size_t width = (kinds[c] == COL_FLAG) ? 1 : 4;
+        if (kinds[c] == COL_INT && ints_mapped) width = 0;
+        bytes += arena_align(width * (size_t)rows, ARENA_ALIGN);
+    }
+    return arena_reserve(&store->arena, bytes);
+}
+
+static inline void table_store_free(TableStore *store) {
+    arena_release(&store->arena);
+    if (store->has_snap) snap_close(&store->snap);
+    if (store->has_csv) csv_close(&store->csv);
+    memset(store, 0, sizeof(*store));
+}
+
+static inline int table_flag(StrView sv) {
+    return sv_equals(sv_unquote(sv), "t") ? 't' : 'f';
+}
+
+// 从快照取列：整数列直接用映射区，字符串和标志列按快照字典换算
+static inline int table_from_snapshot(TableStore *store, const ColumnKind *kinds, int column_count,
+                                      TableColumn *columns) {
+    SnapTable *snap = &store->snap;
+    int rows = snap->row_count;
+    if (table_store_reserve(store, kinds, column_count, rows, 1) != 0) return -1;
+    for (int c = 0; c < column_count; c++) {
+        const SnapColumn *column = &snap->columns[c];
+        if (kinds[c] == COL_INT) {
+            columns[c].ints = (const int*)column->ints;
+        } else if (kinds[c] == COL_STR) {
+            // 快照字典的每一项只驻留一次，再把各行的列内编码换成全局编码
+            StrCode *codes = (StrCode*)table_store_alloc(store, (size_t)rows * sizeof(StrCode));
+            uint32_t dict_count = column->dict_count > 0 ? column->dict_count : 1;
+            StrView *entries = (StrView*)malloc(dict_count * sizeof(StrView));
+            StrCode *by_code = (StrCode*)malloc(dict_count * sizeof(StrCode));
+            int ok = codes && entries && by_code;
+            for (uint32_t k = 0; ok && k < column->dict_count; k++) {
+                entries[k] = sv_unquote(snap_dict_entry(column, k));
+            }
+            if (ok) ok = str_intern_many(entries, (int)column->dict_count, by_code) == 0;
+            for (int r = 0; ok && r < rows; r++) codes[r] = by_code[column->codes[r]];
+            free(entries);
+            free(by_code);
+            if (!ok) return -1;
+            columns[c].codes = codes;
+        } else {
+            // 标志列先按字典算出每个编码对应的字符，再按行查表
+            char *flags = (char*)table_store_alloc(store, (size_t)rows);
+            char *by_code = (char*)malloc(column->dict_count > 0 ? column->dict_count : 1);
+            if (!flags || !by_code) {
+                free(by_code);
+                return -1;
+            }
+            for (uint32_t k = 0; k < column->dict_count; k++) by_code[k] = (char)table_flag(snap_dict_entry(column, k));
+            for (int r = 0; r < rows; r++) flags[r] = by_code[column->codes[r]];
+            free(by_code);
+            columns[c].flags = flags;
+        }
+    }
+    return rows;
+}
+
+// CSV解析时的单元格（一行由column_count个单元格组成）
+typedef union {
+    int i;
+    StrView s;
+    char f;
+} TableCell;
+
+typedef struct {
+    const ColumnKind *kinds;
+    int column_count;
+} TableSchema;
+
+static int table_parse_row(CsvCursor *cursor, StrView line, void *row, void *ctx) {
+    const TableSchema *schema = (const TableSchema*)ctx;
+    TableCell *cells = (TableCell*)row;
+    StrView field;
+    if (csv_line_empty(line)) return 0;
+
+    for (int c = 0; c < schema->column_count; c++) {
+        if (!csv_next_field(cursor, &field)) {
+            field.ptr = line.ptr;
+            field.len = 0;
+        }
+        if (schema->kinds[c] == COL_INT) {
+            cells[c].i = sv_to_int(field);
+        } else if (schema->kinds[c] == COL_STR) {
+            cells[c].s = sv_unquote(field);
+        } else {
+            cells[c].f = (char)table_flag(field);
+        }
+    }
+    return 1;
+}
+
+// 快照不可用时直接解析CSV（多线程按行解析，再按列转置，字符串列驻留到全局字典）
+static inline int table_from_csv(TableStore *store, const char *filename, const ColumnKind *kinds,
+                                 int column_count, TableColumn *columns) {
+    if (csv_open(&store->csv, filename) != 0) {
+        printf("无法打开文件: %s，错误原因：%s\n", filename, strerror(errno));
+        return -1;
+    }
+    store->has_csv = 1;
+
+    TableSchema schema = { kinds, column_count };
+    TableCell *cells = NULL;
+    int rows = csv_parse_parallel(&store->csv, column_count * sizeof(TableCell), table_parse_row,
+                                  &schema, (void**)&cells);
+    if (rows < 0) return -1;
+
+    int ok = table_store_reserve(store, kinds, column_count, rows, 0) == 0;
+    for (int c = 0; c < column_count && ok; c++) {
+        if (kinds[c] == COL_INT) {
+            int *ints = (int*)table_store_alloc(store, (size_t)rows * sizeof(int));
+            if (!ints) ok = 0;
+            for (int r = 0; ok && r < rows; r++) ints[r] = cells[(size_t)r * column_count + c].i;
+            columns[c].ints = ints;
+        } else if (kinds[c] == COL_STR) {
+            StrCode *codes = (StrCode*)table_store_alloc(store, (size_t)rows * sizeof(StrCode));
+            StrView *strs = (StrView*)malloc((size_t)(rows > 0 ? rows : 1) * sizeof(StrView));
+            if (!codes || !strs) ok = 0;
+            for (int r = 0; ok && r < rows; r++) strs[r] = cells[(size_t)r * column_count + c].s;
+            if (ok) ok = str_intern_many(strs, rows, codes) == 0;
+            free(strs);
+            columns[c].codes = codes;
+        } else {
+            char *flags = (char*)table_store_alloc(store, (size_t)rows);
+            if (!flags) ok = 0;
+            for (int r = 0; ok && r < rows; r++) flags[r] = cells[(size_t)r * column_count + c].f;
+            columns[c].flags = flags;
+        }
+    }
+    free(cells);
+
+    // 字符串已复制进全局字典，CSV映射不再需要
+    csv_close(&store->csv);
+    store->has_csv = 0;
+    if (!ok) printf("内存不足，无法加载文件: %s\n", filename);
+    return ok ? rows : -1;
+}
+
+// 加载一张表：优先映射列存快照（过期或不存在时先由CSV生成），快照不可用时才直接解析CSV。
+// 返回行数，失败返回-1（store中已分配的资源仍需table_store_free释放）
+static inline int table_load(TableStore *store, const char *filename, const ColumnKind *kinds,
+                             int column_count, TableColumn *columns) {
+    SnapColumnType schema[TABLE_MAX_COLUMNS];
+    memset(store, 0, sizeof(*store));
+    for (int c = 0; c < column_count; c++) schema[c] = (kinds[c] == COL_INT) ? SNAP_INT : SNAP_STR;
+
+    if (snap_open(&store->snap, filename, schema, column_count) == 0) {
+        store->has_snap = 1;
+        return table_from_snapshot(store, kinds, column_count, columns);
+    }
+    return table_from_csv(store, filename, kinds, column_count, columns);
+}
+
+// ---------- 各表加载与释放（失败返回-1，表保持为空） ----------
+
+static inline int load_set_table(SetTable *table, const char *filename) {
+    static const ColumnKind kinds[] = { COL_STR, COL_STR, COL_INT, COL_INT };
+    TableColumn columns[4];
+    int rows = table_load(&table->store, filename, kinds, 4, columns);
+    if (rows < 0) {
+        table_store_free(&table->store);
+        table->count = 0;
+        return -1;
+    }
+    table->count = rows;
+    table->set_num = columns[0].codes;
+    table->name = columns[1].codes;
+    table->year = columns[2].ints;
+    table->theme_id = columns[3].ints;
+    return rows;
+}
+
+static inline int load_theme_table(ThemeTable *table, const char *filename) {
+    static const ColumnKind kinds[] = { COL_INT, COL_STR, COL_INT };
+    TableColumn columns[3];
+    int rows = table_load(&table->store, filename, kinds, 3, columns);
+    if (rows < 0) {
+        table_store_free(&table->store);
+        table->count = 0;
+        return -1;
+    }
+    table->count = rows;
+    table->id = columns[0].ints;
+    table->name = columns[1].codes;
+    table->parent_id = columns[2].ints;
+    return rows;
+}
+
+static inline int load_inventory_table(InventoryTable *table, const char *filename) {
+    static const ColumnKind kinds[] = { COL_INT, COL_INT, COL_STR };
+    TableColumn columns[3];
+    int rows = table_load(&table->store, filename, kinds, 3, columns);
+    if (rows < 0) {
+        table_store_free(&table->store);
+        table->count = 0;
+        return -1;
+    }
+    table->count = rows;
+    table->id = columns[0].ints;
+    table->version = columns[1].ints;
+    table->set_num = columns[2].codes;
+    return rows;
+}
+
+static inline int load_inventory_part_table(InventoryPartTable *table, const char *filename) {
+    static const ColumnKind kinds[] = { COL_INT, COL_STR, COL_INT, COL_INT, COL_FLAG };
+    TableColumn columns[5];
+    int rows = table_load(&table->store, filename, kinds, 5, columns);
+    if (rows < 0) {
+        table_store_free(&table->store);
+        table->count = 0;
+        return -1;
+    }
+    table->count = rows;
+    table->inventory_id = columns[0].ints;
+    table->part_num = columns[1].codes;
+    table->color_id = columns[2].ints;
+    table->quantity = columns[3].ints;
+    table->is_spare = columns[4].flags;
+    return rows;
+}
+
+static inline int load_color_table(ColorTable *table, const char *filename) {
+    static const ColumnKind kinds[] = { COL_INT, COL_STR, COL_STR, COL_STR };
+    TableColumn columns[4];
+    int rows = table_load(&table->store, filename, kinds, 4, columns);
+    if (rows < 0) {
+        table_store_free(&table->store);
+        table->count = 0;
+        return -1;
+    }
+    table->count = rows;
+    table->id = columns[0].ints;
+    table->name = columns[1].codes;
+    table->rgb = columns[2].codes;
+    table->is_trans = columns[3].codes;
+    return rows;
+}
+
+static inline void free_set_table(SetTable *table) {
+    table_store_free(&table->store);
+    table->count = 0;
+}
+
+static inline void free_theme_table(ThemeTable *table) {
+    table_store_free(&table->store);
+    table->count = 0;
+}
+
+static inline void free_inventory_table(InventoryTable *table) {
+    table_store_free(&table->store);
+    table->count = 0;
+}
+
+static inline void free_inventory_part_table(InventoryPartTable *table) {
+    table_store_free(&table->store);
+    table->count = 0;
+}
+
+static inline void free_color_table(ColorTable *table) {
+    table_store_free(&table->store);
+    table->count = 0;
+}
+
+// ---------- 逐行兼容视图 ----------
+
+static inline void set_row(const SetTable *table, int i, Set *row) {
+    sv_copy(str_dict_get(table->set_num[i]), row->set_num, sizeof(row->set_num));
+    sv_copy(str_dict_get(table->name[i]), row->name, sizeof(row->name));
+    row->year = table->year[i];
+    row->theme_id = table->theme_id[i];
+}
+
+static inline void theme_row(const ThemeTable *table, int i, Theme *row) {
+    row->id = table->id[i];
+    sv_copy(str_dict_get(table->name[i]), row->name, sizeof(row->name));
+    row->parent_id = table->parent_id[i];
+}
+
+static inline void inventory_row(const InventoryTable *table, int i, Inventory *row) {
+    row->id = table->id[i];
+    row->version = table->version[i];
+    sv_copy(str_dict_get(table->set_num[i]), row->set_num, sizeof(row->set_num));
+}
+
+static inline void inventory_part_row(const InventoryPartTable *table, int i, InventoryPart *row) {
+    row->inventory_id = table->inventory_id[i];
+    sv_copy(str_dict_get(table->part_num[i]), row->part_num, sizeof(row->part_num));
+    row->color_id = table->color_id[i];
+    row->quantity = table->quantity[i];
+    row->is_spare = table->is_spare[i];
+}
+
+static inline void color_row(const ColorTable *table, int i, Color *row) {
+    row->id = table->id[i];
+    sv_copy(str_dict_get(table->name[i]), row->name, sizeof(row->name));
+    sv_copy(str_dict_get(table->rgb[i]), row->rgb, sizeof(row->rgb));
+    sv_copy(str_dict_get(table->is_trans[i]), row->is_trans, sizeof(row->is_trans));
+}
+
+#endif
@@ -0,0 +1,398 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "LegoJoin.h"
+#include "QueryProtocol.h"
+
+// 多客户端并发压测：一组客户端线程各自不停地发出查询（发一个、等它完成、再发下一个），
+// 查询混合RetrievalMultiple的关联查询（JOIN_QUERY_DEFAULT）和空闲零件扫描，统计吞吐量（QPS）和延迟分位数，
+// 客户端数按 1、2、4 … 64 逐级增加，看工作线程数固定时吞吐量何时饱和、延迟怎样随排队增长。
+// 两种模式：
+//   默认在进程内压测：五张表读一次、只读共享，请求交给固定大小的工作线程池执行，
+//     客户端线程只提交和等待（task_group_wait_idle，不帮忙执行），延迟 = 排队 + 执行；
+//   --socket 路径：压测已启动的QueryServer，每个客户端一个连接，延迟还包括收发和编解码，工作线程数由服务端的--workers决定。
+// 每级先运行ramp秒不计数（让线程都起来、缓存热起来），再统计之后duration秒内完成的请求；
+// 每个请求的结果行数都和单线程执行的结果比对，不一致算失败。
+// 用法：LoadBench [--workers N] [--clients 1,2,4,8,16,32,64] [--duration 秒] [--ramp 秒]
+//                 [--join 关联查询所占百分比] [--socket 路径] [--csv 文件]
+
+#define MAX_CLIENTS 256
+#define MAX_LEVELS 32
+
+typedef enum {
+    REQUEST_JOIN = 0,
+    REQUEST_SPARE = 1,
+    REQUEST_KINDS
+} RequestKind;
+
+static const char *const requestNames[REQUEST_KINDS] = { "join", "spare" };
+
+// 一个客户端在测量窗口内完成的请求的延迟（秒）
+typedef struct {
+    double *values;
+    int count, capacity;
+} LatencyLog;
+
+typedef struct {
+    unsigned int seed;            // 决定请求种类的随机数状态
+    LatencyLog log[REQUEST_KINDS];
+    long failed[REQUEST_KINDS];
+    int fd;                       // --socket模式的连接
+    uint32_t nextId;
+    // 进程内模式：交给线程池的请求
+    TaskGroup done;
+    RequestKind kind;
+    int rows;                     // 结果行数，失败为-1
+    pthread_t thread;
+} Client;
+
+static const char *socketPath;        // NULL表示进程内模式
+static int workers;
+static int joinPercent = 50;
+static TableLoad tables;
+static ThreadPool *pool;
+static int expected[REQUEST_KINDS];   // 单线程执行时的结果行数
+static double measureStart, measureEnd;
+static char requestBody[REQUEST_KINDS][64];
+static uint32_t requestLength[REQUEST_KINDS];
+
+typedef struct {
+    long requests, failed;
+    double qps, mean, p50, p90, p99, p999, max;  // 延迟为毫秒
+} LevelStats;
+
+static int logAppend(LatencyLog *log, double value) {
+    if (log->count == log->capacity) {
+        int capacity = log->capacity ? log->capacity * 2 : 1024;
+        double *values = (double*)realloc(log->values, capacity * sizeof(double));
+        if (!values) return -1;
+        log->values = values;
+        log->capacity = capacity;
+    }
+    log->values[log->count++] = value;
+    return 0;
+}
+
+// 线程池里执行一个请求：各表只读，中间结构放在这个请求自己的arena里
+static void executeRequest(void *arg) {
+    Client *client = (Client*)arg;
+    TableLoad *t = &tables;
+    Arena arena;
+    arena_init(&arena);
+    if (client->kind == REQUEST_JOIN) {
+        JoinQuery query = JOIN_QUERY_DEFAULT;
+        int count = 0;
+        Result *results = multiTableJoinQuery(&t->sets, &t->themes, &t->inventories, &t->inventoryParts,
+                                              &t->colors, &query, &arena, &count);
+        client->rows = results ? count : -1;
+    } else {
+        int *rows = (int*)arena_alloc(&arena, (t->inventoryParts.count > 0 ? t->inventoryParts.count : 1) * sizeof(int));
+        client->rows = rows ? filterParts(&t->inventoryParts, 1, -1, 0, 0, rows) : -1;
+    }
+    arena_release(&arena);
+}
+
+// 发出一个请求并等它完成，返回结果行数，失败返回-1
+static int issueRequest(Client *client, RequestKind kind) {
+    if (!socketPath) {
+        client->kind = kind;
+        thread_pool_submit(pool, &client->done, executeRequest, client);
+        task_group_wait_idle(pool, &client->done);
+        return client->rows;
+    }
+
+    QueryHeader reply;
+    char *body;
+    uint16_t type = kind == REQUEST_JOIN ? QUERY_JOIN : QUERY_PARTS;
+    if (query_call(client->fd, type, ++client->nextId, requestBody[kind], requestLength[kind],
+                   &reply, &body) != 0) {
+        return -1;
+    }
+    int rows = -1;
+    if (reply.status == QUERY_OK) {
+        QueryReader reader;
+        query_reader_init(&reader, body, reply.length);
+        uint32_t count = query_get_u32(&reader);
+        if (!reader.error) rows = (int)count;
+    }
+    free(body);
+    return rows;
+}
+
+// 客户端线程：到测量窗口结束为止不停地发请求，只记录在窗口内完成的请求
+static void* clientMain(void *arg) {
+    Client *client = (Client*)arg;
+    for (;;) {
+        double start = bench_now();
+        if (start >= measureEnd) break;
+        RequestKind kind = (int)(rand_r(&client->seed) % 100) < joinPercent ? REQUEST_JOIN : REQUEST_SPARE;
+        int rows = issueRequest(client, kind);
+        double end = bench_now();
+        if (rows < 0 && socketPath) {
+            // 连接已断开，之后的请求不会再成功
+            client->failed[kind]++;
+            break;
+        }
+        if (end < measureStart || end > measureEnd) continue;
+        if (rows != expected[kind] || logAppend(&client->log[kind], end - start) != 0) {
+            client->failed[kind]++;
+        }
+    }
+    return NULL;
+}
+
+// 最近秩百分位：不小于permille‰样本的最小值
+static double percentile(const double *sorted, long n, int permille) {
+    long rank = ((long long)permille * n + 999) / 1000;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// 汇总客户端的延迟，kind为REQUEST_KINDS时统计全部请求
+static int levelStats(Client *clients, int clientCount, int kind, double duration, LevelStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    long n = 0;
+    for (int c = 0; c < clientCount; c++) {
+        for (int k = 0; k < REQUEST_KINDS; k++) {
+            if (kind != REQUEST_KINDS && kind != k) continue;
+            n += clients[c].log[k].count;
+            stats->failed += clients[c].failed[k];
+        }
+    }
+    stats->requests = n;
+    stats->qps = n / duration;
+    if (n == 0) return 0;
+    double *values = (double*)malloc(n * sizeof(double));
+    if (!values) return -1;
+    long i = 0;
+    double sum = 0.0;
+    for (int c = 0; c < clientCount; c++) {
+        for (int k = 0; k < REQUEST_KINDS; k++) {
+            if (kind != REQUEST_KINDS && kind != k) continue;
+            for (int r = 0; r < clients[c].log[k].count; r++) {
+                values[i] = clients[c].log[k].values[r] * 1e3;
+                sum += values[i++];
+            }
+        }
+    }
+    qsort(values, n, sizeof(double), bench_compare_double);
+    stats->mean = sum / n;
+    stats->p50 = percentile(values, n, 500);
+    stats->p90 = percentile(values, n, 900);
+    stats->p99 = percentile(values, n, 990);
+    stats->p999 = percentile(values, n, 999);
+    stats->max = values[n - 1];
+    free(values);
+    return 0;
+}
+
+static void writeCsv(const char *path, int clientCount, const char *kind, const LevelStats *s, long timestamp) {
+    FILE *out = fopen(path, "a");
+    if (!out) {
+        perror("无法写入压测CSV文件");
+        return;
+    }
+    fseek(out, 0, SEEK_END);
+    if (ftell(out) == 0) {
+        fprintf(out, "timestamp,name,mode,workers,clients,kind,requests,failed,"
+                     "qps,mean_ms,p50_ms,p90_ms,p99_ms,p999_ms,max_ms\n");
+    }
+    fprintf(out, "%ld,LoadBench,%s,%d,%d,%s,%ld,%ld,%.1f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+            timestamp, socketPath ? "socket" : "local", workers, clientCount, kind,
+            s->requests, s->failed, s->qps, s->mean, s->p50, s->p90, s->p99, s->p999, s->max);
+    if (fclose(out) != 0) perror("无法写入压测CSV文件");
+}
+
+// 以clientCount个客户端运行一级，打印并按需写出统计。客户端起不来返回-1
+static int runLevel(int clientCount, double ramp, double duration, const char *csvPath) {
+    static Client clients[MAX_CLIENTS];
+    int started = 0, result = 0;
+
+    memset(clients, 0, sizeof(Client) * clientCount);
+    for (int c = 0; c < clientCount; c++) {
+        clients[c].seed = 2023u + (unsigned int)c * 7919u;
+        clients[c].fd = -1;
+        if (socketPath && (clients[c].fd = query_connect(socketPath)) < 0) {
+            printf("无法连接查询服务 %s：%s\n", socketPath, strerror(errno));
+            result = -1;
+            break;
+        }
+    }
+    measureStart = bench_now() + ramp;
+    measureEnd = measureStart + duration;
+    while (result == 0 && started < clientCount) {
+        if (pthread_create(&clients[started].thread, NULL, clientMain, &clients[started]) != 0) {
+            perror("客户端线程创建失败");
+            result = -1;
+            break;
+        }
+        started++;
+    }
+    for (int c = 0; c < started; c++) pthread_join(clients[c].thread, NULL);
+
+    if (result == 0) {
+        long timestamp = (long)time(NULL);
+        // 先是全部请求，再分种类
+        for (int i = 0; i <= REQUEST_KINDS; i++) {
+            int kind = (i + REQUEST_KINDS) % (REQUEST_KINDS + 1);
+            LevelStats s;
+            const char *name = kind == REQUEST_KINDS ? "all" : requestNames[kind];
+            if (levelStats(clients, clientCount, kind, duration, &s) != 0) {
+                printf("压测统计内存分配失败\n");
+                result = -1;
+                break;
+            }
+            if (kind == REQUEST_KINDS) {
+                printf("%7d", clientCount);
+            } else {
+                printf("%7s", "");
+            }
+            printf(" %-6s %9ld %7ld %9.1f %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n", name, s.requests,
+                   s.failed, s.qps, s.mean, s.p50, s.p90, s.p99, s.p999, s.max);
+            if (csvPath) writeCsv(csvPath, clientCount, name, &s, timestamp);
+        }
+    }
+    fflush(stdout);
+
+    for (int c = 0; c < clientCount; c++) {
+        for (int k = 0; k < REQUEST_KINDS; k++) free(clients[c].log[k].values);
+        if (clients[c].fd >= 0) close(clients[c].fd);
+    }
+    return result;
+}
+
+// 解析 "1,2,4" 形式的客户端数列表，返回级数，不合法返回-1
+static int parseLevels(const char *text, int *levels) {
+    int count = 0;
+    const char *p = text;
+    while (*p) {
+        char *end;
+        long n = strtol(p, &end, 10);
+        if (end == p || n < 1 || n > MAX_CLIENTS || count == MAX_LEVELS) return -1;
+        levels[count++] = (int)n;
+        if (*end == ',') end++;
+        else if (*end != '\0') return -1;
+        p = end;
+    }
+    return count > 0 ? count : -1;
+}
+
+// 组装--socket模式的两种请求（与QueryClient的join、spare默认参数相同）
+static void buildRequests(void) {
+    JoinQuery query = JOIN_QUERY_DEFAULT;
+    QueryWriter writer;
+    query_writer_init(&writer, requestBody[REQUEST_JOIN], sizeof(requestBody[REQUEST_JOIN]));
+    query_put_i32(&writer, query.yearFrom);
+    query_put_i32(&writer, query.yearTo);
+    query_put_i32(&writer, query.minQuantity);
+    query_put_i32(&writer, query.limit);
+    query_put_str(&writer, query.themeName, strlen(query.themeName));
+    query_put_str(&writer, query.colorName, strlen(query.colorName));
+    requestLength[REQUEST_JOIN] = (uint32_t)(writer.p - requestBody[REQUEST_JOIN]);
+
+    query_writer_init(&writer, requestBody[REQUEST_SPARE], sizeof(requestBody[REQUEST_SPARE]));
+    query_put_i32(&writer, 1);
+    query_put_i32(&writer, -1);
+    query_put_i32(&writer, 0);
+    query_put_i32(&writer, 0);
+    requestLength[REQUEST_SPARE] = (uint32_t)(writer.p - requestBody[REQUEST_SPARE]);
+}
+
+int main(int argc, char *argv[]) {
+    int levels[MAX_LEVELS] = { 1, 2, 4, 8, 16, 32, 64 };
+    int levelCount = 7;
+    double duration = 3.0, ramp = 0.5;
+    const char *csvPath = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        int hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--workers") == 0 && hasValue) {
+            workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--clients") == 0 && hasValue) {
+            levelCount = parseLevels(argv[++i], levels);
+        } else if (strcmp(argv[i], "--duration") == 0 && hasValue) {
+            duration = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--ramp") == 0 && hasValue) {
+            ramp = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--join") == 0 && hasValue) {
+            joinPercent = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--socket") == 0 && hasValue) {
+            socketPath = argv[++i];
+        } else if (strcmp(argv[i], "--csv") == 0 && hasValue) {
+            csvPath = argv[++i];
+        } else {
+            levelCount = -1;
+            break;
+        }
+    }
+    if (levelCount < 0 || duration <= 0 || ramp < 0 || joinPercent < 0 || joinPercent > 100) {
+        printf("用法：%s [--workers N] [--clients 1,2,4,8,16,32,64] [--duration 秒] [--ramp 秒] "
+               "[--join 百分比] [--socket 路径] [--csv 文件]\n", argv[0]);
+        return 1;
+    }
+
+    Client probe;
+    memset(&probe, 0, sizeof(probe));
+    probe.fd = -1;
+    if (socketPath) {
+        buildRequests();
+        probe.fd = query_connect(socketPath);
+        if (probe.fd < 0) {
+            printf("无法连接查询服务 %s：%s\n", socketPath, strerror(errno));
+            return 1;
+        }
+    } else {
+        double start = bench_now();
+        if (loadTables(&tables) != 0) {
+            printf("文件读取失败，无法压测\n");
+            freeTables(&tables);
+            str_dict_release();
+            return 1;
+        }
+        printf("五张表读取完成 | inventory_parts：%d 行 | 耗时：%.2f 毫秒\n",
+               tables.inventoryParts.count, (bench_now() - start) * 1000);
+        pool = thread_pool_create(workers);
+        if (!pool) {
+            printf("工作线程池创建失败\n");
+            freeTables(&tables);
+            str_dict_release();
+            return 1;
+        }
+        workers = pool->thread_count;
+    }
+
+    // 单个客户端先各执行一次，得到用来核对的结果行数
+    for (int k = 0; k < REQUEST_KINDS; k++) {
+        expected[k] = issueRequest(&probe, (RequestKind)k);
+        if (expected[k] < 0) {
+            printf("%s查询执行失败，无法压测\n", requestNames[k]);
+            return 1;
+        }
+    }
+    if (probe.fd >= 0) close(probe.fd);
+
+    if (socketPath) {
+        printf("压测查询服务 %s | 工作线程数由服务端决定", socketPath);
+    } else {
+        printf("进程内压测 | 工作线程：%d", workers);
+    }
+    printf(" | 关联查询占 %d%%（%d 行），空闲零件扫描占 %d%%（%d 行）| 每级预热 %.1f 秒、统计 %.1f 秒\n",
+           joinPercent, expected[REQUEST_JOIN], 100 - joinPercent,
+           expected[REQUEST_SPARE], ramp, duration);
+    printf("\n%7s %-6s %9s %7s %9s %9s %9s %9s %9s %9s %9s  （延迟单位：毫秒）\n", "clients", "kind",
+           "requests", "failed", "QPS", "mean", "p50", "p90", "p99", "p99.9", "max");
+
+    int result = 0;
+    for (int l = 0; l < levelCount && result == 0; l++) {
+        result = runLevel(levels[l], ramp, duration, csvPath);
+    }
+
+    if (pool) {
+        thread_pool_destroy(pool);
+        freeTables(&tables);
+        str_dict_release();
+    }
+    return result == 0 ? 0 : 1;
+}
@@ -1,161 +1,226 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
-
-#define MAX_LINE_LENGTH 4096  // 支持长行
+#include "CsvMap.h"
+#include "UpdatePlan.h"
+#include "OutWriter.h"
+#include "ThreadPool.h"
+#include "Arena.h"
+#include "Bench.h"
+
+#define MAX_LINE_LENGTH 4096  // 输出路径和改写后一行的缓冲区长度
 #define NUM_COPIES 5
-
-// 解析CSV行，提取3个字段的原始内容（含引号），并确定字段边界
-// 返回值：1=解析成功；通过指针传出3个字段（含原始引号）和字段结束位置
-int parse_csv_fields(const char *line, char *part_num, char *name, char *part_cat_id, int *end_pos) {
-    int in_quotes = 0;       // 是否在引号内
-    int field_idx = 0;       // 当前字段索引（0:part_num, 1:name, 2:part_cat_id）
-    int start = 0;           // 当前字段的起始位置
-    const char *p = line;
-
-    // 初始化输出
-    *part_num = *name = *part_cat_id = '\0';
-    *end_pos = 0;
-
-    while (*p != '\0' && field_idx < 3) {
-        if (*p == '"') {
-            in_quotes = !in_quotes;  // 切换引号状态
-        } else if (*p == ',' && !in_quotes) {
-            // 遇到字段分隔符（不在引号内），提取当前字段
-            int len = p - line - start;
-            if (len > 0) {
-                switch (field_idx) {
-                    case 0:
-                        strncpy(part_num, line + start, len);
-                        part_num[len] = '\0';
-                        break;
-                    case 1:
-                        strncpy(name, line + start, len);
-                        name[len] = '\0';
-                        break;
-                }
-            }
-            field_idx++;
-            start = p - line + 1;  // 下一个字段的起始位置
-        }
-        p++;
+#define INPUT_FILE_PATH "D:\\SQLlab\\lego\\data\\parts.csv"
+
+// 用法：NewUpdate [语句] [--runs N] [--warmup N] [--csv 文件] [--json 文件] [--cache warm|cold|direct|mem] [--perf]
+// 执行的语句默认是 PARTS_UPDATE_SQL，也可以作为第一个参数传入，例如：
+//   NewUpdate "SET name = name || ' (old)', part_cat_id = part_cat_id + 1000 WHERE part_cat_id >= 20"
+// 语句在启动时编译成执行计划（UpdatePlan.h），逐行只做比较和拼接。
+// parts.csv只映射、扫描一次：改写后的行和它们在输入中的位置记成一份修改清单，
+// 再由线程池同时生成各个副本。副本里两次修改之间连续的未修改行作为一整段，从输入文件原样照抄
+// （OutWriter.h的out_copy，段长时用copy_file_range在内核里复制），生成副本接近直接复制文件的开销
+
+// 一处修改：先照抄输入中[copy_from, copy_from + copy_len)，再写改写后的行
+typedef struct {
+    size_t copy_from, copy_len;
+    const char *text;
+    size_t text_len;
+} RowEdit;
+
+typedef struct {
+    const CsvFile *input;
+    int input_fd;          // 供out_copy在内核里复制，打不开时为-1（退回从映射区拷贝）
+    RowEdit *edits;
+    int edit_count, edit_cap;
+    size_t tail_from;      // 最后一处修改之后，从这里照抄到文件末尾
+    int add_newline;       // 输入最后一行没有换行符，补一个
+    uint64_t output_size;
+    Arena texts;           // 改写后各行的文本
+} UpdateScript;
+
+typedef struct {
+    const UpdateScript *script;
+    char output_file_path[MAX_LINE_LENGTH];
+    double duration;
+    int error;             // 失败时的errno
+} CopyTask;
+
+static int add_edit(UpdateScript *script, size_t copy_from, size_t copy_len, const StrView *fields) {
+    if (script->edit_count == script->edit_cap) {
+        int cap = script->edit_cap ? script->edit_cap * 2 : 256;
+        RowEdit *edits = (RowEdit*)realloc(script->edits, cap * sizeof(RowEdit));
+        if (!edits) return -1;
+        script->edits = edits;
+        script->edit_cap = cap;
     }
-
-    // 提取最后一个字段（part_cat_id）
-    if (field_idx == 2) {
-        int len = p - line - start;
-        if (len > 0) {
-            strncpy(part_cat_id, line + start, len);
-            part_cat_id[len] = '\0';
-        }
+    size_t len = PARTS_COLUMN_COUNT - 1;
+    for (int f = 0; f < PARTS_COLUMN_COUNT; f++) len += fields[f].len;
+    char *text = (char*)arena_alloc(&script->texts, len);
+    if (!text) return -1;
+    char *p = text;
+    for (int f = 0; f < PARTS_COLUMN_COUNT; f++) {
+        if (f > 0) *p++ = ',';
+        memcpy(p, fields[f].ptr, fields[f].len);
+        p += fields[f].len;
     }
-
-    *end_pos = p - line;  // 记录行结束位置
-    // 验证3个字段是否有效（非空）
-    return (strlen(part_num) > 0 && strlen(name) > 0 && strlen(part_cat_id) > 0) ? 1 : 0;
+    RowEdit *edit = &script->edits[script->edit_count++];
+    edit->copy_from = copy_from;
+    edit->copy_len = copy_len;
+    edit->text = text;
+    edit->text_len = len;
+    script->output_size += copy_len + len;
+    return 0;
 }
 
-// 移除字段的外层引号（仅用于判断part_cat_id是否为1，不改变原始输出）
-void remove_quotes(const char *src, char *dest) {
-    int len = strlen(src);
-    if (len >= 2 && src[0] == '"' && src[len-1] == '"') {
-        strncpy(dest, src + 1, len - 2);  // 去掉首尾引号
-        dest[len - 2] = '\0';
-    } else {
-        strcpy(dest, src);  // 无引号则直接复制
+// 扫描一遍输入，按执行计划生成修改清单（表头不参与，字段保留原始引号，改写后的行沿用原来的行尾）。
+// 返回修改的行数，内存不足返回-1
+static int build_update_script(UpdateScript *script, const UpdatePlan *plan, int *line_count) {
+    const CsvFile *input = script->input;
+    CsvCursor cursor;
+    StrView line, fields[PARTS_COLUMN_COUNT];
+    char row_buffer[MAX_LINE_LENGTH];
+    size_t copy_from = 0;  // 尚未写出的未修改行从这里开始
+
+    *line_count = 0;
+    csv_cursor_init(&cursor, input);
+    while (csv_next_line(&cursor, &line)) {
+        (*line_count)++;
+        if (*line_count == 1) continue;
+        int matched = update_plan_execute(plan, cursor.fields, cursor.field_count,
+                                          fields, row_buffer, sizeof(row_buffer));
+        if (!update_plan_report(matched, *line_count)) continue;
+
+        size_t line_start = (size_t)(line.ptr - input->data);
+        if (add_edit(script, copy_from, line_start - copy_from, fields) != 0) return -1;
+        copy_from = line_start + line.len;
     }
+    script->tail_from = copy_from;
+    script->add_newline = input->size > 0 && input->data[input->size - 1] != '\n';
+    script->output_size += input->size - copy_from + script->add_newline;
+    return script->edit_count;
 }
 
-int main() {
-    FILE *input_file, *output_file;
-    char line[MAX_LINE_LENGTH];
-    char part_num[MAX_LINE_LENGTH], name[MAX_LINE_LENGTH], part_cat_id[MAX_LINE_LENGTH];
-    char part_cat_id_clean[MAX_LINE_LENGTH];  // 用于判断的去引号版本
-    clock_t start, end;
-    double duration, total_time = 0.0;
-    int end_pos;  // 记录行解析的结束位置
-
-    const char *input_file_path = "D:\\SQLlab\\lego\\data\\parts.csv";
-
-    for (int i = 1; i <= NUM_COPIES; ++i) {
-        char output_file_path[MAX_LINE_LENGTH];
-        sprintf(output_file_path, "D:\\SQLlab\\lego\\data\\parts_copy%d.csv", i);
-
-        input_file = fopen(input_file_path, "r");
-        if (!input_file) {
-            perror("无法打开输入文件");
-            return 1;
-        }
-        output_file = fopen(output_file_path, "w");
-        if (!output_file) {
-            perror("无法打开输出文件");
-            fclose(input_file);
-            return 1;
-        }
-
-        start = clock();
-        int line_count = 0, modified_count = 0;
-
-        while (fgets(line, MAX_LINE_LENGTH, input_file)) {
-            line_count++;
-            // 移除行尾换行符（保留其他字符）
-            line[strcspn(line, "\r\n")] = '\0';
-
-            // 解析3个字段（保留原始引号）
-            if (!parse_csv_fields(line, part_num, name, part_cat_id, &end_pos)) {
-                // 解析失败时，直接写入原始行（完全不修改）
-                fprintf(output_file, "%s\n", line);
-                continue;
-            }
+// 按修改清单生成一个副本：先写临时文件，完整写完再改名，中途退出不会留下写了一半的副本
+static void write_copy(void *arg) {
+    CopyTask *task = (CopyTask*)arg;
+    const UpdateScript *script = task->script;
+    const char *data = script->input->data;
+    char temp_file_path[MAX_LINE_LENGTH + 8];
+    OutWriter out;
+    double start = bench_now();
+
+    sprintf(temp_file_path, "%s.tmp", task->output_file_path);
+    if (out_open(&out, temp_file_path, OUT_PLAIN) != 0) {
+        task->error = errno;
+        return;
+    }
+    out_preallocate(out.fd, script->output_size);
+    for (int e = 0; e < script->edit_count; e++) {
+        const RowEdit *edit = &script->edits[e];
+        out_copy(&out, script->input_fd, edit->copy_from, data + edit->copy_from, edit->copy_len);
+        out_write(&out, edit->text, edit->text_len);
+    }
+    out_copy(&out, script->input_fd, script->tail_from, data + script->tail_from,
+             script->input->size - script->tail_from);
+    if (script->add_newline) out_char(&out, '\n');
+
+#ifdef _WIN32
+    remove(task->output_file_path);  // Windows上rename不能覆盖已有文件
+#endif
+    if (out_close(&out) != 0 || rename(temp_file_path, task->output_file_path) != 0) {
+        task->error = errno;
+        remove(temp_file_path);
+    }
+    task->duration = bench_now() - start;
+}
 
-            // 清理part_cat_id的引号（仅用于判断是否为1）
-            remove_quotes(part_cat_id, part_cat_id_clean);
-
-            if (strcmp(part_cat_id_clean, "1") == 0) {
-                // 处理需要修改的行：
-                // 1. part_num添加前缀"new_"（保留原始引号）
-                // 2. name保持原始格式（含引号）
-                // 3. part_cat_id改为"100"（若原字段有引号，保留引号格式）
-                char new_part_num[MAX_LINE_LENGTH];
-                if (part_num[0] == '"') {
-                    // 原始part_num带引号，在引号内添加前缀（如"123" → "new_123"）
-                    sprintf(new_part_num, "\"new_%s", part_num + 1);
-                } else {
-                    // 原始part_num无引号，直接添加前缀（如123 → new_123）
-                    sprintf(new_part_num, "new_%s", part_num);
-                }
-
-                char new_cat_id[MAX_LINE_LENGTH];
-                if (part_cat_id[0] == '"') {
-                    // 原始part_cat_id带引号，新值也带引号（如"1" → "100"）
-                    strcpy(new_cat_id, "\"100\"");
-                } else {
-                    // 原始part_cat_id无引号，新值也不带引号（如1 → 100）
-                    strcpy(new_cat_id, "100");
-                }
-
-                // 写入修改后的行（保留所有引号格式）
-                fprintf(output_file, "%s,%s,%s\n", new_part_num, name, new_cat_id);
-                modified_count++;
+// 一次完整的生成：映射并扫描输入，并发写出各副本。成功返回0
+static int run_once(const UpdatePlan *plan, Bench *bench) {
+    CsvFile input;
+    UpdateScript script;
+    CopyTask tasks[NUM_COPIES];
+    const char *input_file_path = INPUT_FILE_PATH;
+
+    bench_phase(bench, "load");
+    if (csv_open(&input, input_file_path) != 0) {
+        perror("无法打开输入文件");
+        return -1;
+    }
+    memset(&script, 0, sizeof(script));
+    script.input = &input;
+    script.input_fd = open(input_file_path, O_RDONLY);
+    arena_init(&script.texts);
+
+    bench_phase(bench, "build");
+    int line_count;
+    int modified_count = build_update_script(&script, plan, &line_count);
+    if (modified_count < 0) {
+        printf("内存不足\n");
+    } else {
+        printf("扫描 %s 完成 | 总行数：%d | 修改行数：%d | 耗时：%.4f 秒\n",
+               input_file_path, line_count, modified_count, bench_phase_time(bench, "build"));
+
+        bench_phase(bench, "output");
+        ThreadPool *pool = thread_pool_shared();
+        TaskGroup group = {0};
+        for (int i = 0; i < NUM_COPIES; i++) {
+            memset(&tasks[i], 0, sizeof(tasks[i]));
+            tasks[i].script = &script;
+            sprintf(tasks[i].output_file_path, "D:\\SQLlab\\lego\\data\\parts_copy%d.csv", i + 1);
+            if (pool) {
+                thread_pool_submit(pool, &group, write_copy, &tasks[i]);
             } else {
-                // 不需要修改的行，完全保留原始格式（包括所有引号和逗号）
-                fprintf(output_file, "%s\n", line);
+                write_copy(&tasks[i]);
             }
         }
+        if (pool) task_group_wait(pool, &group);
+    }
 
-        end = clock();
-        duration = (double)(end - start) / CLOCKS_PER_SEC;
-        total_time += duration;
-
-        printf("生成文件 %s 完成 | 总行数：%d | 修改行数：%d | 耗时：%.4f 秒\n",
-               output_file_path, line_count, modified_count, duration);
+    bench_phase(bench, "free");
+    if (script.input_fd >= 0) close(script.input_fd);
+    csv_close(&input);
+    free(script.edits);
+    arena_release(&script.texts);
+    if (modified_count < 0) return -1;
+
+    int failed = 0;
+    for (int i = 0; i < NUM_COPIES; i++) {
+        if (tasks[i].error) {
+            errno = tasks[i].error;
+            perror("无法写入输出文件");
+            failed = 1;
+            continue;
+        }
+        printf("生成文件 %s 完成 | 大小：%llu 字节 | 耗时：%.4f 秒\n", tasks[i].output_file_path,
+               (unsigned long long)script.output_size, tasks[i].duration);
+    }
+    return failed ? -1 : 0;
+}
 
-        fclose(input_file);
-        fclose(output_file);
+int main(int argc, char *argv[]) {
+    UpdatePlan plan;
+    Bench bench;
+    char error[256];
+    int result = 0;
+
+    bench_init(&bench, "NewUpdate", 1, 0);
+    bench_input(&bench, INPUT_FILE_PATH);
+    if (bench_parse_args(&bench, &argc, argv) != 0) return 1;
+    const char *sql = argc > 1 ? argv[1] : PARTS_UPDATE_SQL;
+    if (update_plan_compile(&plan, sql, PARTS_COLUMNS, PARTS_COLUMN_COUNT, error, sizeof(error)) != 0) {
+        printf("语句错误：%s\n", error);
+        return 1;
     }
 
-    printf("\n所有文件生成完成 | 总耗时：%.4f 秒 | 平均耗时：%.4f 秒\n",
-           total_time, total_time / NUM_COPIES);
-    return 0;
-}
\ No newline at end of file
+    while (bench_next_run(&bench)) {
+        result = run_once(&plan, &bench);
+        double total_time = bench_run_end(&bench, result == 0);
+        if (result != 0) break;
+        printf("\n所有文件生成完成 | 总耗时：%.4f 秒 | 平均耗时：%.4f 秒\n",
+               total_time, total_time / NUM_COPIES);
+    }
+    if (bench.runs > 1 || bench.csv_path || bench.json_path || bench.perf_enabled) bench_report(&bench);
+    bench_free(&bench);
+    return result == 0 ? 0 : 1;
+}
@@ -0,0 +1,385 @@
+#ifndef OUT_WRITER_H
+#define OUT_WRITER_H
+
+// 输出写入器：代替逐行fprintf/fputs。行内容直接拼进一块大的用户态缓冲区（整数用查表转换，
+// 不解析格式串、不加stdio锁），缓冲区满了才用一次write/writev交给内核。
+// 单次写入的数据块很大时不再拷贝，连同缓冲区里已有的内容一起用一次writev写出；
+// 原样照抄输入文件中的一大段时（out_copy），用copy_file_range/sendfile在内核里复制，数据不进用户态。
+// out_attach_at建立定位写入器：从指定偏移开始用pwrite/pwritev写，不改fd的文件偏移，
+// 多个线程可以各用一个写入器往同一个fd（事先用out_preallocate分配好空间）的不同区域并发写。
+//
+// 三种写出方式（out_open/out_attach的mode参数，不支持时自动退回OUT_PLAIN，实际方式见mode字段）：
+//   OUT_PLAIN ：普通write，数据经过页缓存；
+//   OUT_DIRECT：O_DIRECT直接写盘，不占页缓存，适合生成很大而且不会马上再读的文件。
+//               缓冲区按OUT_BLOCK对齐，平时只写整块，关闭时最后不足一块的尾部退出直接I/O再写；
+//               文件系统不支持（如tmpfs）时退回普通写；
+//   OUT_SPLICE：输出是管道时用vmsplice把缓冲区的页直接挂进管道，不拷贝。两块缓冲区轮流使用，
+//               管道容量设成不超过一块缓冲区：一块完整挂进管道时，上一块必然已被读端取走，可以重新填写。
+//               读端需要用read读取（读端再splice出去时页可能仍被引用）。
+// 写出失败后记下errno，之后的写入都丢弃，out_close返回-1。
+// Linux上O_DIRECT、vmsplice、fallocate等需要_GNU_SOURCE，使用本文件的程序要在第一个#include之前定义。
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+// Windows上没有writev和对齐分配，逐段write，两种特殊写出方式都不可用
+#include <io.h>
+#define OUT_NO_WRITEV
+struct iovec {
+    void *iov_base;
+    size_t iov_len;
+};
+#else
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <sys/sendfile.h>
+#ifndef F_SETPIPE_SZ
+#define F_SETPIPE_SZ 1031
+#define F_GETPIPE_SZ 1032
+#endif
+#ifdef SYS_vmsplice
+#define OUT_HAVE_SPLICE
+#endif
+#endif
+
+#define OUT_BUFFER_SIZE (1 << 20)  // 缓冲区大小（vmsplice方式是每块的大小）
+#define OUT_BLOCK 4096             // O_DIRECT的对齐单位；out_reserve一次最多预留这么多
+#define OUT_COPY_MIN (64 << 10)    // out_copy的数据段不短于这个长度才在内核里复制，短的拷进缓冲区更省
+
+typedef enum {
+    OUT_PLAIN = 0,
+    OUT_DIRECT = 1,
+    OUT_SPLICE = 2
+} OutMode;
+
+typedef struct {
+    int fd;
+    int owns_fd;       // out_close时是否关闭fd
+    OutMode mode;      // 实际生效的写出方式
+    char *memory;      // 分配的内存（vmsplice方式是相邻的两块缓冲区）
+    char *buffer;      // 正在填写的缓冲区
+    size_t len;
+    size_t cap;
+    int half;          // vmsplice方式正在填写的是第几块
+    int error;         // 第一次写出失败的errno
+    int no_copy_range; // copy_file_range不可用（内核太旧、跨文件系统等），改用sendfile
+    int no_sendfile;   // sendfile也不可用，out_copy只能拷贝
+    int64_t at;        // 定位写入器下一次写的文件偏移，-1表示按fd的当前偏移写
+    uint64_t bytes;    // 已交给内核的字节数
+    uint64_t calls;    // 写出用的系统调用次数
+} OutWriter;
+
+// 写出iov的全部内容（处理部分写入和EINTR），已写出的部分从iov中去掉（失败时iov里剩下未写出的）。成功返回0
+static inline int out_write_fully(OutWriter *w, struct iovec *iov, int count) {
+    while (count > 0) {
+#ifdef OUT_NO_WRITEV
+        long n = -1;
+        if (w->at < 0 || _lseeki64(w->fd, w->at, SEEK_SET) >= 0) {  // 没有pwrite，定位写入器不能共用fd
+            n = write(w->fd, iov->iov_base, (unsigned int)iov->iov_len);
+        }
+#else
+        ssize_t n;
+        if (w->at >= 0) {
+            n = count == 1 ? pwrite(w->fd, iov->iov_base, iov->iov_len, (off_t)w->at)
+                           : pwritev(w->fd, iov, count, (off_t)w->at);
+        } else {
+            n = count == 1 ? write(w->fd, iov->iov_base, iov->iov_len) : writev(w->fd, iov, count);
+        }
+#endif
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            w->error = errno;
+            return -1;
+        }
+        w->calls++;
+        w->bytes += (uint64_t)n;
+        if (w->at >= 0) w->at += n;
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= (long)iov->iov_len;
+            iov->iov_base = (char*)iov->iov_base + iov->iov_len;
+            iov->iov_len = 0;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+    return 0;
+}
+
+#ifdef OUT_HAVE_SPLICE
+static inline int out_splice_fully(OutWriter *w, char *data, size_t len) {
+    while (len > 0) {
+        struct iovec iov = {data, len};
+        long n = syscall(SYS_vmsplice, w->fd, &iov, 1UL, 0U);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            w->error = errno;
+            return -1;
+        }
+        w->calls++;
+        w->bytes += (uint64_t)n;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+#endif
+
+static inline void out_leave_direct(OutWriter *w) {
+#ifdef O_DIRECT
+    int flags = fcntl(w->fd, F_GETFL);
+    if (flags != -1) fcntl(w->fd, F_SETFL, flags & ~O_DIRECT);
+#endif
+    w->mode = OUT_PLAIN;
+}
+
+// 写出缓冲区。O_DIRECT方式平时只写整块，不足一块的尾部留在缓冲区开头；final时把尾部也写完
+static inline void out_drain(OutWriter *w, int final) {
+    if (w->error || w->len == 0) {
+        w->len = 0;
+        return;
+    }
+#ifdef OUT_HAVE_SPLICE
+    if (w->mode == OUT_SPLICE) {
+        // 挂进管道的页在读端取走之前不能改，换另一块缓冲区继续填写
+        if (out_splice_fully(w, w->buffer, w->len) == 0) {
+            w->half ^= 1;
+            w->buffer = w->memory + (size_t)w->half * w->cap;
+        }
+        w->len = 0;
+        return;
+    }
+#endif
+    if (w->mode == OUT_DIRECT) {
+        struct iovec iov = {w->buffer, w->len / OUT_BLOCK * OUT_BLOCK};
+        if (iov.iov_len > 0 && out_write_fully(w, &iov, 1) != 0 && w->error == EINVAL) {
+            w->error = 0;  // 文件系统不支持直接I/O，余下的改用普通写
+            out_leave_direct(w);
+        }
+        size_t done = (size_t)((char*)iov.iov_base - w->buffer);
+        memmove(w->buffer, w->buffer + done, w->len - done);
+        w->len -= done;
+        if (w->error) {
+            w->len = 0;
+            return;
+        }
+        if (w->mode == OUT_DIRECT) {
+            if (!final || w->len == 0) return;
+            out_leave_direct(w);
+        }
+    }
+    struct iovec iov = {w->buffer, w->len};
+    out_write_fully(w, &iov, 1);
+    w->len = 0;
+}
+
+// 在已打开的fd上建立写入器，owns_fd为1时out_close会关闭fd。成功返回0
+static inline int out_attach(OutWriter *w, int fd, int owns_fd, OutMode mode) {
+    memset(w, 0, sizeof(*w));
+    w->fd = fd;
+    w->owns_fd = owns_fd;
+    w->cap = OUT_BUFFER_SIZE;
+    w->mode = mode;
+    w->at = -1;
+    if (mode == OUT_SPLICE) {
+        w->mode = OUT_PLAIN;
+#ifdef OUT_HAVE_SPLICE
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode)) {
+            fcntl(fd, F_SETPIPE_SZ, (int)w->cap);  // 失败时保留原来的容量，只要不超过一块缓冲区就行
+            int size = fcntl(fd, F_GETPIPE_SZ);
+            if (size > 0 && (size_t)size <= w->cap) w->mode = OUT_SPLICE;
+        }
+#endif
+    }
+    void *memory;
+#ifdef OUT_NO_WRITEV
+    memory = malloc(w->cap);
+    if (!memory) return -1;
+#else
+    if (posix_memalign(&memory, OUT_BLOCK, w->mode == OUT_SPLICE ? 2 * w->cap : w->cap) != 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+#endif
+    w->memory = w->buffer = (char*)memory;
+    return 0;
+}
+
+// 创建（截断）文件并建立写入器，成功返回0，失败返回-1（errno保留失败原因）
+static inline int out_open(OutWriter *w, const char *path, OutMode mode) {
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;  // 与fopen(path, "w")相同
+    int fd = -1;
+#ifdef O_DIRECT
+    if (mode == OUT_DIRECT) {
+        fd = open(path, flags | O_DIRECT, 0644);
+        if (fd < 0 && errno != EINVAL) return -1;
+    }
+#endif
+    if (fd < 0) {
+        if (mode == OUT_DIRECT) mode = OUT_PLAIN;
+        fd = open(path, flags, 0644);
+        if (fd < 0) return -1;
+    }
+    if (out_attach(w, fd, 1, mode) != 0) {
+        close(fd);
+        return -1;
+    }
+    return 0;
+}
+
+// 定位写入器：从fd的offset处开始写（普通写出方式），out_close不关闭fd
+static inline int out_attach_at(OutWriter *w, int fd, uint64_t offset) {
+    if (out_attach(w, fd, 0, OUT_PLAIN) != 0) return -1;
+    w->at = (int64_t)offset;
+    return 0;
+}
+
+// 预先为文件分配size字节并把文件长度设为size，减少边写边分配和碎片。
+// 只是优化：文件系统不支持时什么也不做（不用posix_fallocate，它在不支持时会逐块写0）
+static inline void out_preallocate(int fd, uint64_t size) {
+#if defined(__linux__) && defined(SYS_fallocate)
+    if (size > 0) syscall(SYS_fallocate, fd, 0, (int64_t)0, (int64_t)size);
+#else
+    (void)fd;
+    (void)size;
+#endif
+}
+
+// 写出剩余内容并释放缓冲区，全部写出成功返回0，否则返回-1（errno保留第一次失败的原因）
+static inline int out_close(OutWriter *w) {
+    out_drain(w, 1);
+    int error = w->error;
+    if (w->owns_fd && close(w->fd) != 0 && !error) error = errno;
+    free(w->memory);
+    w->memory = w->buffer = NULL;
+    w->cap = 0;
+    if (error) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+// 预留n（不超过OUT_BLOCK）字节，直接写进返回的位置后用out_commit确认
+static inline char* out_reserve(OutWriter *w, size_t n) {
+    if (w->cap - w->len < n) out_drain(w, 0);
+    return w->buffer + w->len;
+}
+
+static inline void out_commit(OutWriter *w, size_t n) {
+    w->len += n;
+}
+
+static inline void out_write(OutWriter *w, const void *data, size_t len) {
+    if (len <= w->cap - w->len) {
+        memcpy(w->buffer + w->len, data, len);
+        w->len += len;
+        return;
+    }
+    if (w->mode == OUT_PLAIN && len >= w->cap / 2) {
+        if (!w->error) {
+            struct iovec iov[2] = {{w->buffer, w->len}, {(void*)data, len}};
+            out_write_fully(w, iov, 2);
+        }
+        w->len = 0;
+        return;
+    }
+    const char *p = (const char*)data;
+    while (len > 0) {
+        if (w->len == w->cap) out_drain(w, 0);
+        size_t n = w->cap - w->len < len ? w->cap - w->len : len;
+        memcpy(w->buffer + w->len, p, n);
+        w->len += n;
+        p += n;
+        len -= n;
+    }
+}
+
+static inline void out_char(OutWriter *w, char c) {
+    if (w->len == w->cap) out_drain(w, 0);
+    w->buffer[w->len++] = c;
+}
+
+static inline void out_str(OutWriter *w, const char *s) {
+    out_write(w, s, strlen(s));
+}
+
+// 十进制整数，每次查表转换两位
+static inline void out_int(OutWriter *w, int value) {
+    static const char digits[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    char tmp[10], *t = tmp + sizeof(tmp);
+    unsigned int u = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    while (u >= 100) {
+        unsigned int r = u % 100;
+        u /= 100;
+        t -= 2;
+        memcpy(t, digits + r * 2, 2);
+    }
+    if (u >= 10) {
+        t -= 2;
+        memcpy(t, digits + u * 2, 2);
+    } else {
+        *--t = (char)('0' + u);
+    }
+    size_t n = (size_t)(tmp + sizeof(tmp) - t);
+    char *p = out_reserve(w, n + 1);
+    size_t len = 0;
+    if (value < 0) p[len++] = '-';
+    memcpy(p + len, t, n);
+    out_commit(w, len + n);
+}
+
+// 照抄文件src_fd中从offset开始的len字节，data是同一段内容在内存中的位置（如mmap映射区）。
+// 普通写出方式下足够长的段先写出缓冲区，再在内核里从src_fd复制到输出；不支持时退回拷贝data
+static inline void out_copy(OutWriter *w, int src_fd, uint64_t offset, const char *data, size_t len) {
+#ifdef __linux__
+    if (w->mode == OUT_PLAIN && src_fd >= 0 && len >= OUT_COPY_MIN && !w->no_sendfile) {
+        out_drain(w, 0);
+        size_t done = 0;
+        while (done < len && !w->error && !w->no_sendfile) {
+            long n;
+            if (!w->no_copy_range) {
+                int64_t off = (int64_t)(offset + done);
+                n = syscall(SYS_copy_file_range, src_fd, &off, w->fd, w->at >= 0 ? &w->at : NULL, len - done, 0U);
+                if (n < 0 && errno != EINTR) w->no_copy_range = 1;
+            } else if (w->at >= 0) {
+                break;  // sendfile只能写到fd的当前偏移，定位写入器改为拷贝
+            } else {
+                off_t off = (off_t)(offset + done);
+                n = sendfile(w->fd, src_fd, &off, len - done);
+                if (n < 0 && errno != EINTR) w->no_sendfile = 1;
+            }
+            if (n == 0) break;  // 源文件比预期的短，剩下的从data拷贝
+            if (n > 0) {
+                done += (size_t)n;
+                w->bytes += (uint64_t)n;
+                w->calls++;
+            }
+        }
+        data += done;
+        len -= done;
+    }
+#else
+    (void)src_fd;
+    (void)offset;
+#endif
+    out_write(w, data, len);
+}
+
+#endif
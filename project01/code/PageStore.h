@@ -0,0 +1,857 @@
+#ifndef PAGE_STORE_H
+#define PAGE_STORE_H
+
+// 分槽页存储：把CSV的每一行按字段存成一条元组，放进固定大小的页里，更新时只改动涉及的页。
+//
+// 文件布局：第0页是文件头，第1页起是数据页。数据页的结构：
+//   PageHeader | PageSlot[slot_count] → 空闲空间 ← 元组（从页尾往前放）
+// 行号RowId = 页号<<16 | 槽号，行搬动后保持不变：
+//   新内容在本页放得下就原地改写（必要时先整理本页碎片）；放不下就搬到空闲空间映射找到的页，
+//   原位置留一条转发记录指向新位置，搬来的元组带TUPLE_MOVED_IN标记和原位置的行号，顺序扫描时只从原位置经转发取到。
+// 空闲空间映射（"<路径>.fsm"）每页一个字节，以PAGE_FSM_UNIT字节为单位记录可用空间（向下取整），
+// 找页时只看这张表，不用读数据页；刷盘时只写回变化的那一段。
+// 页通过一个固定帧数的缓冲池读写（时钟置换），只有被改过的页会写回文件，
+// 所以一次更新写出的数据量与改动的行数成正比，而不是与文件大小成正比。
+// 批量建立时每页预留(100-PAGE_FILL_FACTOR)%的空间，让变长的更新尽量留在原页。
+// 配合预写日志（Wal.h）使用时，用page_store_set_write_hook挂上"先让日志落盘"的回调，
+// 缓冲池写回任何一页之前都会先调用它。
+// 崩溃时各页分别停在各自最后一次写回的状态，恢复靠重放日志里的整行内容，因此：
+//   追加新页时，新页和记下新页数的文件头先落盘，之后写回的页里的转发记录不会指向文件外；
+//   转发目标的页可能比原位置的页旧，跟随转发时核对目标是不是这一行搬过去的元组（比较元组里记的原位置），
+//   对不上时更新会把新内容重新放到别处；空闲空间映射只是提示，不记日志，与页内容不符时按实际空间修正。
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "CsvMap.h"
+
+#define PAGE_SIZE 8192
+#define PAGE_MAGIC "LEGOPAG1"
+#define PAGE_VERSION 2                     // 2：搬来的元组记下原位置的行号
+#define PAGE_POOL_FRAMES 64                // 缓冲池帧数
+#define PAGE_FILL_FACTOR 90                // 批量建立时每页最多填到90%
+#define PAGE_FSM_UNIT (PAGE_SIZE / 256)    // 空闲空间映射一个单位的字节数
+#define PAGE_NONE UINT32_MAX
+
+#define TUPLE_MOVED_IN 1   // 从别的页搬来的元组，由原位置的转发记录找到
+#define TUPLE_FORWARD 2    // 转发记录：正文是新位置的RowId
+#define TUPLE_MIN_SIZE 10  // 元组至少占10字节，保证任何位置都能原地改成转发记录
+#define TUPLE_MAX_FIELDS CSV_MAX_FIELDS
+
+typedef uint64_t RowId;
+#define ROW_ID(page, slot) (((RowId)(page) << 16) | (RowId)(slot))
+#define ROW_PAGE(rid) ((uint32_t)((rid) >> 16))
+#define ROW_SLOT(rid) ((uint16_t)((rid) & 0xFFFF))
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t page_size;
+    uint32_t page_count;   // 含文件头页
+    uint32_t reserved0;
+    uint64_t row_count;
+} PageFileHeader;
+
+typedef struct {
+    uint16_t slot_count;
+    uint16_t lower;        // 槽数组的末尾
+    uint16_t upper;        // 元组区的起点
+    uint16_t garbage;      // 元组区里已废弃、整理后可回收的字节数
+} PageHeader;
+
+typedef struct {
+    uint16_t offset;
+    uint16_t len;          // 分配给元组的字节数，0表示空槽
+} PageSlot;
+
+#define PAGE_TUPLE_MAX (PAGE_SIZE - sizeof(PageHeader) - sizeof(PageSlot))
+
+typedef struct {
+    uint32_t page;         // PAGE_NONE表示空帧
+    int pins;
+    int dirty;
+    int referenced;        // 时钟置换的访问位
+    char *data;
+} PageFrame;
+
+typedef struct {
+    int fd;
+    int fsm_fd;
+    uint32_t page_count;
+    uint64_t row_count;
+    int header_dirty;
+    PageFrame frames[PAGE_POOL_FRAMES];
+    char *frame_memory;
+    int *frame_of;                // 页号 → 帧下标，-1表示不在缓冲池
+    uint32_t frame_of_cap;
+    int clock_hand;
+    uint8_t *fsm;                 // 空闲空间映射（常驻内存）
+    uint32_t fsm_cap;
+    uint32_t fsm_dirty_lo, fsm_dirty_hi;  // 待写回的区间[lo, hi)
+    uint32_t fsm_hint;            // 上次找到空闲空间的页
+    uint64_t pages_read, pages_written, bytes_written;
+    int (*before_write)(void *ctx);   // 写回数据页之前调用，返回非0则放弃写回
+    void *write_ctx;
+} PageStore;
+
+// 读出的一行：字段指向data里的拷贝，与缓冲池无关
+typedef struct {
+    RowId rid;
+    int field_count;
+    StrView fields[TUPLE_MAX_FIELDS];
+    char data[PAGE_SIZE];
+} PageTuple;
+
+typedef struct {
+    uint32_t page;
+    uint16_t slot;
+} PageScan;
+
+static inline PageHeader* page_header(char *data) {
+    return (PageHeader*)data;
+}
+
+static inline PageSlot* page_slots(char *data) {
+    return (PageSlot*)(data + sizeof(PageHeader));
+}
+
+static inline void page_init(char *data) {
+    memset(data, 0, PAGE_SIZE);
+    PageHeader *h = page_header(data);
+    h->lower = sizeof(PageHeader);
+    h->upper = PAGE_SIZE;
+}
+
+// 整理后可用的空间
+static inline size_t page_free_total(const char *data) {
+    const PageHeader *h = (const PageHeader*)data;
+    return (size_t)(h->upper - h->lower) + h->garbage;
+}
+
+// ---- 元组编码：flags(1) | 字段数(1) | 各字段的结束偏移uint16[n] | 字段正文 [| 原位置RowId] ----
+// 带TUPLE_MOVED_IN的元组在正文后面多存原位置的行号
+
+static inline size_t tuple_size(const StrView *fields, int n) {
+    size_t size = 2 + 2 * (size_t)n;
+    for (int i = 0; i < n; i++) size += fields[i].len;
+    return size < TUPLE_MIN_SIZE ? TUPLE_MIN_SIZE : size;
+}
+
+// 搬到别的页时的长度（多存原位置的行号）
+static inline size_t tuple_moved_size(const StrView *fields, int n) {
+    size_t size = 2 + 2 * (size_t)n + sizeof(RowId);
+    for (int i = 0; i < n; i++) size += fields[i].len;
+    return size < TUPLE_MIN_SIZE ? TUPLE_MIN_SIZE : size;
+}
+
+static inline void tuple_encode(char *dst, uint8_t flags, const StrView *fields, int n) {
+    char *text = dst + 2 + 2 * n;
+    uint16_t end = 0;
+    dst[0] = (char)flags;
+    dst[1] = (char)n;
+    for (int i = 0; i < n; i++) {
+        memcpy(text + end, fields[i].ptr, fields[i].len);
+        end = (uint16_t)(end + fields[i].len);
+        memcpy(dst + 2 + 2 * i, &end, 2);
+    }
+}
+
+// 元组除原位置行号以外的长度
+static inline size_t tuple_body_size(const char *src) {
+    int n = (uint8_t)src[1];
+    uint16_t end = 0;
+    if (n > 0) memcpy(&end, src + 2 + 2 * (n - 1), 2);
+    return 2 + 2 * (size_t)n + end;
+}
+
+static inline void tuple_set_home(char *dst, RowId home) {
+    memcpy(dst + tuple_body_size(dst), &home, sizeof(home));
+}
+
+static inline void tuple_encode_forward(char *dst, RowId target) {
+    dst[0] = TUPLE_FORWARD;
+    dst[1] = 0;
+    memcpy(dst + 2, &target, sizeof(target));
+}
+
+static inline RowId tuple_forward_target(const char *src) {
+    RowId target;
+    memcpy(&target, src + 2, sizeof(target));
+    return target;
+}
+
+static inline void tuple_decode(const char *src, PageTuple *tuple) {
+    int n = (uint8_t)src[1];
+    uint16_t end = 0;
+    memcpy(tuple->data, src, tuple_body_size(src));
+    const char *text = tuple->data + 2 + 2 * n;
+    uint16_t start = 0;
+    for (int i = 0; i < n; i++) {
+        memcpy(&end, tuple->data + 2 + 2 * i, 2);
+        tuple->fields[i].ptr = text + start;
+        tuple->fields[i].len = end - start;
+        start = end;
+    }
+    tuple->field_count = n;
+}
+
+// ---- 页内操作 ----
+
+// 把有效元组紧凑地移到页尾，回收废弃空间
+static inline void page_compact(char *data) {
+    char tmp[PAGE_SIZE];
+    PageHeader *h = page_header(data);
+    PageSlot *slots = page_slots(data);
+    uint16_t upper = PAGE_SIZE;
+    for (int i = 0; i < h->slot_count; i++) {
+        if (slots[i].len == 0) continue;
+        upper = (uint16_t)(upper - slots[i].len);
+        memcpy(tmp + upper, data + slots[i].offset, slots[i].len);
+        slots[i].offset = upper;
+    }
+    memcpy(data + upper, tmp + upper, PAGE_SIZE - upper);
+    h->upper = upper;
+    h->garbage = 0;
+}
+
+// 放入一条元组，优先复用空槽，返回槽号；放不下返回-1
+static inline int page_insert(char *data, const char *bytes, size_t len) {
+    PageHeader *h = page_header(data);
+    PageSlot *slots = page_slots(data);
+    int slot = -1;
+    for (int i = 0; i < h->slot_count; i++) {
+        if (slots[i].len == 0) {
+            slot = i;
+            break;
+        }
+    }
+    size_t need = len + (slot < 0 ? sizeof(PageSlot) : 0);
+    if (page_free_total(data) < need) return -1;
+    if ((size_t)(h->upper - h->lower) < need) page_compact(data);
+    if (slot < 0) {
+        slot = h->slot_count++;
+        h->lower += sizeof(PageSlot);
+    }
+    h->upper = (uint16_t)(h->upper - len);
+    memcpy(data + h->upper, bytes, len);
+    slots[slot].offset = h->upper;
+    slots[slot].len = (uint16_t)len;
+    return slot;
+}
+
+// 在本页内替换槽里的元组：不超过原分配大小时原地覆盖，否则在本页重新分配；放不下返回-1
+static inline int page_replace(char *data, int slot, const char *bytes, size_t len) {
+    PageHeader *h = page_header(data);
+    PageSlot *s = &page_slots(data)[slot];
+    if (len <= s->len) {
+        memcpy(data + s->offset, bytes, len);
+        return 0;
+    }
+    if (page_free_total(data) + s->len < len) return -1;
+    h->garbage = (uint16_t)(h->garbage + s->len);
+    s->offset = 0;
+    s->len = 0;
+    if ((size_t)(h->upper - h->lower) < len) page_compact(data);
+    h->upper = (uint16_t)(h->upper - len);
+    memcpy(data + h->upper, bytes, len);
+    s->offset = h->upper;
+    s->len = (uint16_t)len;
+    return 0;
+}
+
+// 槽slot里是不是行home搬过来的元组
+static inline int page_moved_tuple_of(char *data, uint16_t slot, RowId home) {
+    if (slot >= page_header(data)->slot_count) return 0;
+    PageSlot s = page_slots(data)[slot];
+    if (s.len < TUPLE_MIN_SIZE || (size_t)s.offset + s.len > PAGE_SIZE) return 0;
+    const char *src = data + s.offset;
+    if ((src[0] & (TUPLE_MOVED_IN | TUPLE_FORWARD)) != TUPLE_MOVED_IN) return 0;
+    if (2 + 2 * (size_t)(uint8_t)src[1] > s.len) return 0;
+    size_t body = tuple_body_size(src);
+    RowId owner;
+    if (body + sizeof(owner) > s.len) return 0;
+    memcpy(&owner, src + body, sizeof(owner));
+    return owner == home;
+}
+
+static inline void page_release_slot(char *data, int slot) {
+    PageSlot *s = &page_slots(data)[slot];
+    page_header(data)->garbage = (uint16_t)(page_header(data)->garbage + s->len);
+    s->offset = 0;
+    s->len = 0;
+}
+
+// ---- 空闲空间映射 ----
+
+static inline uint8_t page_fsm_category(size_t free_bytes) {
+    size_t category = free_bytes / PAGE_FSM_UNIT;
+    return (uint8_t)(category > 255 ? 255 : category);
+}
+
+static inline int page_store_fsm_reserve(PageStore *store, uint32_t count) {
+    if (count <= store->fsm_cap) return 0;
+    uint32_t cap = store->fsm_cap ? store->fsm_cap : 64;
+    while (cap < count) cap *= 2;
+    uint8_t *fsm = (uint8_t*)realloc(store->fsm, cap);
+    if (!fsm) return -1;
+    memset(fsm + store->fsm_cap, 0, cap - store->fsm_cap);
+    store->fsm = fsm;
+    store->fsm_cap = cap;
+    return 0;
+}
+
+static inline void page_store_note_free(PageStore *store, uint32_t page, const char *data) {
+    uint8_t category = page_fsm_category(page_free_total(data));
+    if (store->fsm[page] == category) return;
+    store->fsm[page] = category;
+    if (store->fsm_dirty_lo >= store->fsm_dirty_hi) {
+        store->fsm_dirty_lo = page;
+        store->fsm_dirty_hi = page + 1;
+    } else {
+        if (page < store->fsm_dirty_lo) store->fsm_dirty_lo = page;
+        if (page + 1 > store->fsm_dirty_hi) store->fsm_dirty_hi = page + 1;
+    }
+}
+
+// 从上次的位置开始找一个至少有need字节可用的数据页（不含exclude），没有返回PAGE_NONE
+static inline uint32_t page_store_find_free(PageStore *store, size_t need, uint32_t exclude) {
+    uint32_t data_pages = store->page_count - 1;
+    if (data_pages == 0) return PAGE_NONE;
+    size_t category = (need + PAGE_FSM_UNIT - 1) / PAGE_FSM_UNIT;
+    if (category > 255) return PAGE_NONE;
+    uint32_t page = store->fsm_hint >= 1 && store->fsm_hint < store->page_count ? store->fsm_hint : 1;
+    for (uint32_t n = 0; n < data_pages; n++) {
+        if (page != exclude && store->fsm[page] >= category) {
+            store->fsm_hint = page;
+            return page;
+        }
+        if (++page >= store->page_count) page = 1;
+    }
+    return PAGE_NONE;
+}
+
+// ---- 缓冲池 ----
+
+static inline int page_store_write_page(PageStore *store, uint32_t page, const char *data) {
+    if (store->before_write && store->before_write(store->write_ctx) != 0) return -1;
+    if (pwrite(store->fd, data, PAGE_SIZE, (off_t)page * PAGE_SIZE) != PAGE_SIZE) return -1;
+    store->pages_written++;
+    store->bytes_written += PAGE_SIZE;
+    return 0;
+}
+
+static inline int page_store_map_reserve(PageStore *store, uint32_t count) {
+    if (count <= store->frame_of_cap) return 0;
+    uint32_t cap = store->frame_of_cap ? store->frame_of_cap : 64;
+    while (cap < count) cap *= 2;
+    int *frame_of = (int*)realloc(store->frame_of, cap * sizeof(int));
+    if (!frame_of) return -1;
+    for (uint32_t i = store->frame_of_cap; i < cap; i++) frame_of[i] = -1;
+    store->frame_of = frame_of;
+    store->frame_of_cap = cap;
+    return 0;
+}
+
+// 时钟置换找一个空闲帧，脏页先写回；所有帧都被钉住时返回-1
+static inline int page_store_evict(PageStore *store) {
+    for (int n = 0; n < 2 * PAGE_POOL_FRAMES + 1; n++) {
+        int i = store->clock_hand;
+        PageFrame *frame = &store->frames[i];
+        store->clock_hand = (i + 1) % PAGE_POOL_FRAMES;
+        if (frame->page == PAGE_NONE) return i;
+        if (frame->pins > 0) continue;
+        if (frame->referenced) {
+            frame->referenced = 0;
+            continue;
+        }
+        if (frame->dirty && page_store_write_page(store, frame->page, frame->data) != 0) return -1;
+        store->frame_of[frame->page] = -1;
+        frame->page = PAGE_NONE;
+        frame->dirty = 0;
+        return i;
+    }
+    errno = ENOBUFS;
+    return -1;
+}
+
+// 取得页并钉住，用完调用page_store_unpin。fresh=1表示新页，不从文件读
+static inline char* page_store_fetch(PageStore *store, uint32_t page, int fresh) {
+    if (page_store_map_reserve(store, page + 1) != 0) return NULL;
+    int i = store->frame_of[page];
+    if (i >= 0) {
+        store->frames[i].pins++;
+        store->frames[i].referenced = 1;
+        return store->frames[i].data;
+    }
+    i = page_store_evict(store);
+    if (i < 0) return NULL;
+    PageFrame *frame = &store->frames[i];
+    if (fresh) {
+        page_init(frame->data);
+    } else {
+        if (pread(store->fd, frame->data, PAGE_SIZE, (off_t)page * PAGE_SIZE) != PAGE_SIZE) {
+            if (errno == 0) errno = EIO;
+            return NULL;
+        }
+        store->pages_read++;
+    }
+    frame->page = page;
+    frame->pins = 1;
+    frame->dirty = fresh;
+    frame->referenced = 1;
+    store->frame_of[page] = i;
+    return frame->data;
+}
+
+static inline void page_store_unpin(PageStore *store, uint32_t page, int dirty) {
+    PageFrame *frame = &store->frames[store->frame_of[page]];
+    frame->pins--;
+    if (dirty) frame->dirty = 1;
+}
+
+static inline int page_store_write_header(PageStore *store) {
+    PageFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PAGE_MAGIC, 8);
+    header.version = PAGE_VERSION;
+    header.page_size = PAGE_SIZE;
+    header.page_count = store->page_count;
+    header.row_count = store->row_count;
+    if (pwrite(store->fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) return -1;
+    store->bytes_written += sizeof(header);
+    store->header_dirty = 0;
+    return 0;
+}
+
+// 在文件末尾追加一个空数据页（已钉住）。
+// 先把空页写到文件末尾并落盘，再把新页数写进文件头并落盘，然后才交给调用方：
+// 之后写回的页里可能有指向新页的转发记录，崩溃后新页一定已在文件里、也已计入页数。
+// 只在没有页放得下时才追加，两次fdatasync的开销分摊到一整页的元组上
+static inline char* page_store_new_page(PageStore *store, uint32_t *page) {
+    char empty[PAGE_SIZE];
+    uint32_t new_page = store->page_count;
+    if (page_store_fsm_reserve(store, new_page + 1) != 0 || page_store_map_reserve(store, new_page + 1) != 0) {
+        return NULL;
+    }
+    page_init(empty);
+    if (pwrite(store->fd, empty, PAGE_SIZE, (off_t)new_page * PAGE_SIZE) != PAGE_SIZE ||
+        fdatasync(store->fd) != 0) {
+        return NULL;
+    }
+    store->page_count++;
+    if (page_store_write_header(store) != 0 || fdatasync(store->fd) != 0) {
+        store->page_count--;
+        store->header_dirty = 1;
+        return NULL;
+    }
+    store->pages_written++;
+    store->bytes_written += PAGE_SIZE;
+    char *data = page_store_fetch(store, new_page, 1);
+    if (!data) return NULL;
+    *page = new_page;
+    page_store_note_free(store, *page, data);
+    return data;
+}
+
+// 把元组放到exclude以外某个有空间的页（没有就追加新页），返回新位置
+static inline int page_store_insert_elsewhere(PageStore *store, const char *bytes, size_t len,
+                                              uint32_t exclude, RowId *rid) {
+    for (;;) {
+        uint32_t page = page_store_find_free(store, len + sizeof(PageSlot), exclude);
+        char *data = page == PAGE_NONE ? page_store_new_page(store, &page) : page_store_fetch(store, page, 0);
+        if (!data) return -1;
+        int slot = page_insert(data, bytes, len);
+        page_store_note_free(store, page, data);
+        page_store_unpin(store, page, slot >= 0);
+        if (slot >= 0) {
+            *rid = ROW_ID(page, slot);
+            return 0;
+        }
+        // 映射与页内容不一致（例如映射文件是旧的），已按实际空间修正，继续找
+    }
+}
+
+// ---- 建立、打开、刷盘 ----
+
+static inline int page_store_write_fsm(int fd, const uint8_t *fsm, uint32_t lo, uint32_t hi) {
+    if (hi <= lo) return 0;
+    ssize_t n = pwrite(fd, fsm + lo, hi - lo, lo);
+    return n == (ssize_t)(hi - lo) ? 0 : -1;
+}
+
+// 从CSV批量建立页存储（每一行包括表头都存成一条元组，保留原始引号），成功返回0
+static inline int page_store_create(const char *path, const char *csv_path) {
+    CsvFile csv;
+    if (csv_open(&csv, csv_path) != 0) return -1;
+
+    char tmp_path[1024 + 32], fsm_path[1024 + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp%ld", path, (long)getpid());
+    snprintf(fsm_path, sizeof(fsm_path), "%s.fsm", path);
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    char *page = (char*)malloc(PAGE_SIZE);
+    char *tuple = (char*)malloc(PAGE_SIZE);
+    PageStore meta;
+    memset(&meta, 0, sizeof(meta));
+    if (fd < 0 || !page || !tuple || page_store_fsm_reserve(&meta, 64) != 0) goto fail;
+
+    const size_t reserve = PAGE_SIZE * (100 - PAGE_FILL_FACTOR) / 100;
+    uint32_t page_count = 1;
+    uint64_t rows = 0;
+    CsvCursor cursor;
+    StrView line;
+    page_init(page);
+    csv_cursor_init(&cursor, &csv);
+    while (csv_next_line(&cursor, &line)) {
+        size_t len = tuple_size(cursor.fields, cursor.field_count);
+        if (len > PAGE_TUPLE_MAX) {
+            errno = EFBIG;  // 一行放不进一页
+            goto fail;
+        }
+        PageHeader *h = page_header(page);
+        if (h->slot_count > 0 && (size_t)(h->upper - h->lower) < len + sizeof(PageSlot) + reserve) {
+            if (pwrite(fd, page, PAGE_SIZE, (off_t)page_count * PAGE_SIZE) != PAGE_SIZE) goto fail;
+            if (page_store_fsm_reserve(&meta, page_count + 1) != 0) goto fail;
+            meta.fsm[page_count++] = page_fsm_category(page_free_total(page));
+            page_init(page);
+        }
+        tuple_encode(tuple, 0, cursor.fields, cursor.field_count);
+        page_insert(page, tuple, len);
+        rows++;
+    }
+    if (page_header(page)->slot_count > 0) {
+        if (pwrite(fd, page, PAGE_SIZE, (off_t)page_count * PAGE_SIZE) != PAGE_SIZE) goto fail;
+        if (page_store_fsm_reserve(&meta, page_count + 1) != 0) goto fail;
+        meta.fsm[page_count++] = page_fsm_category(page_free_total(page));
+    }
+
+    memset(page, 0, PAGE_SIZE);
+    PageFileHeader *header = (PageFileHeader*)page;
+    memcpy(header->magic, PAGE_MAGIC, 8);
+    header->version = PAGE_VERSION;
+    header->page_size = PAGE_SIZE;
+    header->page_count = page_count;
+    header->row_count = rows;
+    if (pwrite(fd, page, PAGE_SIZE, 0) != PAGE_SIZE) goto fail;
+    if (close(fd) != 0) {
+        fd = -1;
+        goto fail;
+    }
+    fd = open(fsm_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || page_store_write_fsm(fd, meta.fsm, 0, page_count) != 0 || close(fd) != 0) {
+        fd = -1;
+        goto fail;
+    }
+    if (rename(tmp_path, path) != 0) {
+        fd = -1;
+        goto fail;
+    }
+    free(page);
+    free(tuple);
+    free(meta.fsm);
+    csv_close(&csv);
+    return 0;
+
+fail:
+    {
+        int saved = errno;
+        if (fd >= 0) close(fd);
+        unlink(tmp_path);
+        free(page);
+        free(tuple);
+        free(meta.fsm);
+        csv_close(&csv);
+        errno = saved;
+    }
+    return -1;
+}
+
+static inline void page_store_release(PageStore *store) {
+    if (store->fd >= 0) close(store->fd);
+    if (store->fsm_fd >= 0) close(store->fsm_fd);
+    free(store->frame_memory);
+    free(store->frame_of);
+    free(store->fsm);
+    memset(store, 0, sizeof(*store));
+    store->fd = store->fsm_fd = -1;
+}
+
+// 打开页存储，成功返回0。空闲空间映射文件缺失或页数不符时按数据页重建
+static inline int page_store_open(PageStore *store, const char *path) {
+    char fsm_path[1024 + 8];
+    PageFileHeader header;
+    memset(store, 0, sizeof(*store));
+    store->fd = store->fsm_fd = -1;
+    snprintf(fsm_path, sizeof(fsm_path), "%s.fsm", path);
+
+    store->fd = open(path, O_RDWR);
+    if (store->fd < 0) goto fail;
+    if (pread(store->fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        memcmp(header.magic, PAGE_MAGIC, 8) != 0 || header.version != PAGE_VERSION ||
+        header.page_size != PAGE_SIZE || header.page_count == 0) {
+        errno = EINVAL;
+        goto fail;
+    }
+    store->page_count = header.page_count;
+    store->row_count = header.row_count;
+
+    store->frame_memory = (char*)malloc((size_t)PAGE_POOL_FRAMES * PAGE_SIZE);
+    if (!store->frame_memory || page_store_map_reserve(store, store->page_count) != 0 ||
+        page_store_fsm_reserve(store, store->page_count) != 0) {
+        goto fail;
+    }
+    for (int i = 0; i < PAGE_POOL_FRAMES; i++) {
+        store->frames[i].page = PAGE_NONE;
+        store->frames[i].data = store->frame_memory + (size_t)i * PAGE_SIZE;
+    }
+
+    store->fsm_fd = open(fsm_path, O_RDWR | O_CREAT, 0644);
+    if (store->fsm_fd < 0) goto fail;
+    struct stat st;
+    if (fstat(store->fsm_fd, &st) == 0 && (uint64_t)st.st_size == store->page_count &&
+        pread(store->fsm_fd, store->fsm, store->page_count, 0) == (ssize_t)store->page_count) {
+        return 0;
+    }
+    for (uint32_t page = 1; page < store->page_count; page++) {
+        char *data = page_store_fetch(store, page, 0);
+        if (!data) goto fail;
+        store->fsm[page] = page_fsm_category(page_free_total(data));
+        page_store_unpin(store, page, 0);
+    }
+    store->fsm_dirty_lo = 0;
+    store->fsm_dirty_hi = store->page_count;
+    return 0;
+
+fail:
+    {
+        int saved = errno;
+        page_store_release(store);
+        errno = saved;
+    }
+    return -1;
+}
+
+// 写回脏页、空闲空间映射中变化的区间和文件头，成功返回0
+static inline int page_store_flush(PageStore *store) {
+    for (int i = 0; i < PAGE_POOL_FRAMES; i++) {
+        PageFrame *frame = &store->frames[i];
+        if (frame->page == PAGE_NONE || !frame->dirty) continue;
+        if (page_store_write_page(store, frame->page, frame->data) != 0) return -1;
+        frame->dirty = 0;
+    }
+    if (store->fsm_dirty_hi > store->fsm_dirty_lo) {
+        if (page_store_write_fsm(store->fsm_fd, store->fsm, store->fsm_dirty_lo, store->fsm_dirty_hi) != 0) {
+            return -1;
+        }
+        store->bytes_written += store->fsm_dirty_hi - store->fsm_dirty_lo;
+        store->fsm_dirty_lo = store->fsm_dirty_hi = 0;
+    }
+    if (store->header_dirty && page_store_write_header(store) != 0) return -1;
+    return 0;
+}
+
+static inline void page_store_set_write_hook(PageStore *store, int (*before_write)(void *ctx), void *ctx) {
+    store->before_write = before_write;
+    store->write_ctx = ctx;
+}
+
+// 写回后把数据文件和空闲空间映射同步到磁盘，成功返回0
+static inline int page_store_sync(PageStore *store) {
+    if (page_store_flush(store) != 0) return -1;
+    if (fdatasync(store->fd) != 0 || fdatasync(store->fsm_fd) != 0) return -1;
+    return 0;
+}
+
+// 刷盘并关闭，刷盘失败返回-1（资源照样释放）
+static inline int page_store_close(PageStore *store) {
+    int result = page_store_flush(store);
+    page_store_release(store);
+    return result;
+}
+
+// ---- 读取与更新 ----
+
+// 按行号读出一行（经转发记录取到最新内容），成功返回0。转发目标不是这一行的元组时返回-1（ENOENT）
+static inline int page_store_read(PageStore *store, RowId rid, PageTuple *tuple) {
+    uint32_t page = ROW_PAGE(rid);
+    uint16_t slot = ROW_SLOT(rid);
+    if (page == 0 || page >= store->page_count) goto missing;
+    char *data = page_store_fetch(store, page, 0);
+    if (!data) return -1;
+    if (slot >= page_header(data)->slot_count || page_slots(data)[slot].len == 0) {
+        page_store_unpin(store, page, 0);
+        goto missing;
+    }
+    const char *src = data + page_slots(data)[slot].offset;
+    if (src[0] & TUPLE_FORWARD) {
+        RowId target = tuple_forward_target(src);
+        page_store_unpin(store, page, 0);
+        page = ROW_PAGE(target);
+        slot = ROW_SLOT(target);
+        if (page == 0 || page >= store->page_count) goto missing;
+        data = page_store_fetch(store, page, 0);
+        if (!data) return -1;
+        if (!page_moved_tuple_of(data, slot, rid)) {
+            page_store_unpin(store, page, 0);
+            goto missing;
+        }
+        src = data + page_slots(data)[slot].offset;
+    }
+    tuple_decode(src, tuple);
+    page_store_unpin(store, page, 0);
+    return 0;
+
+missing:
+    errno = ENOENT;
+    return -1;
+}
+
+static inline void page_scan_init(PageScan *scan) {
+    scan->page = 1;
+    scan->slot = 0;
+}
+
+// 按页顺序取下一行（行号为原位置的行号）。返回1=取到，0=结束，-1=读取失败
+static inline int page_scan_next(PageStore *store, PageScan *scan, PageTuple *tuple) {
+    while (scan->page < store->page_count) {
+        uint32_t page = scan->page;
+        char *data = page_store_fetch(store, page, 0);
+        if (!data) return -1;
+        while (scan->slot < page_header(data)->slot_count) {
+            uint16_t slot = scan->slot++;
+            PageSlot s = page_slots(data)[slot];
+            if (s.len == 0) continue;
+            const char *src = data + s.offset;
+            if (src[0] & TUPLE_MOVED_IN) continue;
+            if (src[0] & TUPLE_FORWARD) {
+                page_store_unpin(store, page, 0);
+                if (page_store_read(store, ROW_ID(page, slot), tuple) != 0) return -1;
+            } else {
+                tuple_decode(src, tuple);
+                page_store_unpin(store, page, 0);
+            }
+            tuple->rid = ROW_ID(page, slot);
+            return 1;
+        }
+        page_store_unpin(store, page, 0);
+        scan->page++;
+        scan->slot = 0;
+    }
+    return 0;
+}
+
+// 把行rid的内容换成fields。本页放不下时搬到别的页，原位置改为转发记录，行号不变。成功返回0
+static inline int page_store_update(PageStore *store, RowId rid, const StrView *fields, int n) {
+    char tuple[PAGE_SIZE], stub[TUPLE_MIN_SIZE];
+    size_t len = tuple_size(fields, n);
+    size_t moved_len = tuple_moved_size(fields, n);
+    if (n > TUPLE_MAX_FIELDS || moved_len > PAGE_TUPLE_MAX) {
+        errno = EFBIG;
+        return -1;
+    }
+    uint32_t home = ROW_PAGE(rid);
+    uint16_t home_slot = ROW_SLOT(rid);
+    if (home == 0 || home >= store->page_count) {
+        errno = ENOENT;
+        return -1;
+    }
+    char *data = page_store_fetch(store, home, 0);
+    if (!data) return -1;
+    if (home_slot >= page_header(data)->slot_count || page_slots(data)[home_slot].len == 0) {
+        page_store_unpin(store, home, 0);
+        errno = ENOENT;
+        return -1;
+    }
+
+    const char *src = data + page_slots(data)[home_slot].offset;
+    if (!(src[0] & TUPLE_FORWARD)) {
+        tuple_encode(tuple, 0, fields, n);
+        if (page_replace(data, home_slot, tuple, len) != 0) {
+            // 本页放不下：搬到别的页，原位置改成转发记录（一定放得下）
+            RowId target;
+            tuple[0] = TUPLE_MOVED_IN;
+            tuple_set_home(tuple, rid);
+            if (page_store_insert_elsewhere(store, tuple, moved_len, home, &target) != 0) {
+                page_store_unpin(store, home, 0);
+                return -1;
+            }
+            tuple_encode_forward(stub, target);
+            page_replace(data, home_slot, stub, TUPLE_MIN_SIZE);
+        }
+        page_store_note_free(store, home, data);
+        page_store_unpin(store, home, 1);
+        return 0;
+    }
+
+    // 已经搬走的行：先在现在的位置改写，还放不下就再搬一次，并更新原位置的转发记录。
+    // 崩溃恢复时转发目标可能不是这一行的元组（目标页比原位置的页旧），这时目标当作已丢失，新内容直接放到别处
+    RowId current = tuple_forward_target(src);
+    uint32_t page = ROW_PAGE(current);
+    char *target_data = NULL;
+    if (page != 0 && page < store->page_count) {
+        target_data = page_store_fetch(store, page, 0);
+        if (!target_data) {
+            page_store_unpin(store, home, 0);
+            return -1;
+        }
+        if (!page_moved_tuple_of(target_data, ROW_SLOT(current), rid)) {
+            page_store_unpin(store, page, 0);
+            target_data = NULL;
+        }
+    }
+    tuple_encode(tuple, TUPLE_MOVED_IN, fields, n);
+    tuple_set_home(tuple, rid);
+    if (target_data && page_replace(target_data, ROW_SLOT(current), tuple, moved_len) == 0) {
+        page_store_note_free(store, page, target_data);
+        page_store_unpin(store, page, 1);
+        page_store_unpin(store, home, 0);
+        return 0;
+    }
+    RowId moved;
+    if (page_store_insert_elsewhere(store, tuple, moved_len, target_data ? page : home, &moved) != 0) {
+        if (target_data) page_store_unpin(store, page, 0);
+        page_store_unpin(store, home, 0);
+        return -1;
+    }
+    if (target_data) {
+        page_release_slot(target_data, ROW_SLOT(current));
+        page_store_note_free(store, page, target_data);
+        page_store_unpin(store, page, 1);
+    }
+    tuple_encode_forward(stub, moved);
+    page_replace(data, home_slot, stub, TUPLE_MIN_SIZE);
+    page_store_unpin(store, home, 1);
+    return 0;
+}
+
+// 按扫描顺序把所有行导出为CSV（字段以逗号连接，每行以\n结尾），返回行数，失败返回-1
+static inline long page_store_export_csv(PageStore *store, const char *csv_path) {
+    PageTuple *tuple = (PageTuple*)malloc(sizeof(PageTuple));
+    FILE *out = tuple ? fopen(csv_path, "wb") : NULL;
+    if (!out) {
+        free(tuple);
+        return -1;
+    }
+    setvbuf(out, NULL, _IOFBF, 1 << 20);
+    PageScan scan;
+    long rows = 0;
+    int r;
+    page_scan_init(&scan);
+    while ((r = page_scan_next(store, &scan, tuple)) > 0) {
+        for (int i = 0; i < tuple->field_count; i++) {
+            if (i > 0) fputc(',', out);
+            fwrite(tuple->fields[i].ptr, 1, tuple->fields[i].len, out);
+        }
+        fputc('\n', out);
+        rows++;
+    }
+    free(tuple);
+    if (fclose(out) != 0 || r < 0) return -1;
+    return rows;
+}
+
+#endif
@@ -0,0 +1,300 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "PageStore.h"
+#include "Wal.h"
+#include "ThreadPool.h"
+#include "UpdatePlan.h"
+#include "Bench.h"
+
+// 在页存储（PageStore.h）上执行：顺序扫描找出匹配的行，按行号就地改写，刷盘时只写回改过的页。
+// 每行的新旧内容先写入预写日志（Wal.h），整条语句结束时提交；数据页写回并落盘后做检查点清空日志。
+// 中途崩溃时，下次运行先恢复：已提交的语句重做，没提交的语句按日志里的旧内容撤销，
+// 页存储回到崩溃前最后一次提交的状态，语句不会只执行了一半，可以安全地重新执行。
+// 用法：PageUpdate [--sql 语句] [--reload] [--export 输出CSV] [--wal-bench]
+//   --sql        要执行的UPDATE语句（语法见UpdatePlan.h），默认PARTS_UPDATE_SQL
+//   --reload     重新从parts.csv建立页存储（页存储不存在时自动建立）
+//   --export     更新后把页存储导出为CSV，可与NewUpdate生成的副本比较
+//   --wal-bench  比较三种提交方式的开销：每行fsync、组提交、不同步（每行一个事务，多个客户端并发）
+
+#define INPUT_FILE_PATH "D:\\SQLlab\\lego\\data\\parts.csv"
+#define STORE_FILE_PATH "D:\\SQLlab\\lego\\data\\parts.pages"
+#define WAL_FILE_PATH "D:\\SQLlab\\lego\\data\\parts.pages.wal"
+#define BENCH_STORE_PATH "D:\\SQLlab\\lego\\data\\parts_bench.pages"
+#define BENCH_WAL_PATH "D:\\SQLlab\\lego\\data\\parts_bench.pages.wal"
+#define BENCH_CLIENTS 8
+
+#define WAL_ROW_UPDATE 2  // 日志记录：RowId | uint32新内容长度 | 元组编码的整行新内容 | 整行旧内容
+#define HEADER_ROW ROW_ID(1, 0)  // 表头是建立时的第一行
+
+static PageTuple tuple;
+static UpdatePlan plan;
+
+// 按执行计划计算第line行（按扫描顺序，表头为第1行）的新内容，表头不参与。
+// 行不匹配或改写失败（已打印原因）返回0，匹配返回1并填好fields（新文本写在buffer里）
+static int rewrite_row(const PageTuple *row, int line, char *buffer, size_t size, StrView *fields) {
+    if (row->rid == HEADER_ROW) return 0;
+    return update_plan_report(update_plan_execute(&plan, row->fields, row->field_count, fields, buffer, size), line);
+}
+
+// 先写日志（新内容和撤销用的旧内容old）再改页，返回日志位置，失败返回0
+static uint64_t log_and_update(PageStore *store, Wal *wal, RowId rid, const StrView *fields, int n,
+                               const PageTuple *old) {
+    char payload[sizeof(RowId) + sizeof(uint32_t) + 2 * PAGE_SIZE];
+    uint32_t len = (uint32_t)tuple_size(fields, n);
+    size_t old_len = tuple_size(old->fields, old->field_count);
+    if (len > PAGE_TUPLE_MAX || old_len > PAGE_TUPLE_MAX) return 0;
+    char *p = payload;
+    memcpy(p, &rid, sizeof(rid));
+    p += sizeof(rid);
+    memcpy(p, &len, sizeof(len));
+    p += sizeof(len);
+    tuple_encode(p, 0, fields, n);
+    p += len;
+    tuple_encode(p, 0, old->fields, old->field_count);
+    p += old_len;
+    uint64_t lsn = wal_append(wal, WAL_ROW_UPDATE, payload, (size_t)(p - payload));
+    if (lsn == 0 || page_store_update(store, rid, fields, n) != 0) return 0;
+    return lsn;
+}
+
+// 重放一条日志记录：重做时写整行新内容，撤销时写整行旧内容，重放多次结果相同
+static int apply_logged_update(void *ctx, uint32_t type, const char *payload, size_t len, int undo) {
+    static PageTuple row;
+    RowId rid;
+    uint32_t new_len;
+    size_t head = sizeof(rid) + sizeof(new_len);
+    if (type != WAL_ROW_UPDATE || len < head) return -1;
+    memcpy(&rid, payload, sizeof(rid));
+    memcpy(&new_len, payload + sizeof(rid), sizeof(new_len));
+    if (new_len < TUPLE_MIN_SIZE || new_len > len - head || len - head - new_len < TUPLE_MIN_SIZE) return -1;
+    tuple_decode(payload + head + (undo ? new_len : 0), &row);
+    return page_store_update((PageStore*)ctx, rid, row.fields, row.field_count);
+}
+
+// 缓冲池写回数据页之前先让日志落盘（先写日志原则）
+static int flush_wal_before_write(void *ctx) {
+    return wal_flush((Wal*)ctx);
+}
+
+// 打开页存储和日志，重做已提交、撤销未提交的日志记录，数据页落盘后做检查点。成功返回0
+static int open_store(PageStore *store, Wal *wal, const char *store_path, const char *wal_path, WalSyncMode mode) {
+    if (page_store_open(store, store_path) != 0) {
+        perror("无法打开页存储（旧格式的页存储用--reload重建）");
+        return -1;
+    }
+    if (wal_open(wal, wal_path, mode, apply_logged_update, store) != 0) {
+        perror("无法打开或重放日志");
+        page_store_close(store);
+        return -1;
+    }
+    if (wal->recovered > 0 || wal->rolled_back > 0) {
+        if (page_store_sync(store) != 0 || wal_checkpoint(wal) != 0) {
+            perror("恢复后写回页存储失败");
+            wal_close(wal);
+            page_store_close(store);
+            return -1;
+        }
+        printf("从日志恢复 %ld 条已提交的更新，撤销 %ld 条未提交的更新\n", wal->recovered, wal->rolled_back);
+        store->pages_written = store->bytes_written = 0;  // 统计只算本次执行
+    }
+    page_store_set_write_hook(store, flush_wal_before_write, wal);
+    return 0;
+}
+
+// 数据页落盘后清空日志再关闭，成功返回0
+static int close_store(PageStore *store, Wal *wal) {
+    int result = 0;
+    if (wal_flush(wal) != 0 || page_store_sync(store) != 0 || wal_checkpoint(wal) != 0) result = -1;
+    page_store_set_write_hook(store, NULL, NULL);
+    if (wal_close(wal) != 0) result = -1;
+    if (page_store_close(store) != 0) result = -1;
+    return result;
+}
+
+typedef struct {
+    PageStore *store;
+    Wal *wal;
+    pthread_mutex_t lock;   // 页存储和扫描位置不是线程安全的，由这把锁保护；提交在锁外进行
+    PageScan scan;
+    int scanned;            // 已扫描的行数，报告改写失败的行时用
+    int rows;
+    int failed;
+} BenchShared;
+
+// 一个客户端：取下一行，匹配就写日志并改页，然后单独提交这一行
+static void bench_client(void *arg) {
+    BenchShared *shared = (BenchShared*)arg;
+    PageTuple *row = (PageTuple*)malloc(sizeof(PageTuple));
+    char buffer[PAGE_SIZE];
+    StrView fields[PARTS_COLUMN_COUNT];
+    if (!row) {
+        shared->failed = 1;
+        return;
+    }
+    for (;;) {
+        uint64_t lsn = 0;
+        pthread_mutex_lock(&shared->lock);
+        int result = shared->failed ? 0 : page_scan_next(shared->store, &shared->scan, row);
+        if (result > 0 && rewrite_row(row, ++shared->scanned, buffer, sizeof(buffer), fields)) {
+            lsn = log_and_update(shared->store, shared->wal, row->rid, fields, PARTS_COLUMN_COUNT, row);
+            if (lsn == 0) shared->failed = 1;
+        }
+        if (result < 0) shared->failed = 1;
+        pthread_mutex_unlock(&shared->lock);
+        if (result <= 0) break;
+        if (lsn == 0) continue;
+        if (wal_commit(shared->wal) != 0) {
+            shared->failed = 1;
+            break;
+        }
+        __sync_fetch_and_add(&shared->rows, 1);
+    }
+    free(row);
+}
+
+static int run_wal_bench(void) {
+    static const WalSyncMode modes[] = {WAL_SYNC_EACH, WAL_SYNC_GROUP, WAL_SYNC_NONE};
+    static const char *names[] = {"每行fsync", "组提交", "不同步"};
+    ThreadPool *pool = thread_pool_create(BENCH_CLIENTS);
+    if (!pool) {
+        printf("无法创建客户端线程\n");
+        return 1;
+    }
+
+    for (int m = 0; m < 3; m++) {
+        // 每种方式都从同一份数据开始，匹配的行相同
+        unlink(BENCH_WAL_PATH);
+        if (page_store_create(BENCH_STORE_PATH, INPUT_FILE_PATH) != 0) {
+            perror("无法建立页存储");
+            thread_pool_destroy(pool);
+            return 1;
+        }
+        PageStore store;
+        Wal wal;
+        if (open_store(&store, &wal, BENCH_STORE_PATH, BENCH_WAL_PATH, modes[m]) != 0) {
+            thread_pool_destroy(pool);
+            return 1;
+        }
+
+        BenchShared shared;
+        memset(&shared, 0, sizeof(shared));
+        shared.store = &store;
+        shared.wal = &wal;
+        pthread_mutex_init(&shared.lock, NULL);
+        page_scan_init(&shared.scan);
+        TaskGroup group = {0};
+        double start = bench_now();
+        for (int c = 0; c < BENCH_CLIENTS; c++) thread_pool_submit(pool, &group, bench_client, &shared);
+        task_group_wait(pool, &group);
+        double duration = bench_now() - start;
+        uint64_t syncs = wal.sync_count;
+        pthread_mutex_destroy(&shared.lock);
+
+        if (close_store(&store, &wal) != 0 || shared.failed) {
+            printf("%s：执行失败\n", names[m]);
+            continue;
+        }
+        printf("%-12s | 客户端：%d | 提交行数：%d | fsync次数：%llu | 耗时：%.4f 秒 | %.0f 行/秒\n",
+               names[m], BENCH_CLIENTS, shared.rows, (unsigned long long)syncs, duration,
+               duration > 0 ? shared.rows / duration : 0.0);
+    }
+    thread_pool_destroy(pool);
+    unlink(BENCH_STORE_PATH);
+    unlink(BENCH_STORE_PATH ".fsm");
+    unlink(BENCH_WAL_PATH);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    PageStore store;
+    Wal wal;
+    PageScan scan;
+    double start, end;  // 墙上时间：等待fsync的时间不计入clock()
+    const char *export_path = NULL;
+    const char *sql = PARTS_UPDATE_SQL;
+    char error[256];
+    int reload = 0, bench = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--reload") == 0) {
+            reload = 1;
+        } else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc) {
+            export_path = argv[++i];
+        } else if (strcmp(argv[i], "--sql") == 0 && i + 1 < argc) {
+            sql = argv[++i];
+        } else if (strcmp(argv[i], "--wal-bench") == 0) {
+            bench = 1;
+        } else {
+            printf("用法：%s [--sql 语句] [--reload] [--export 输出CSV] [--wal-bench]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (update_plan_compile(&plan, sql, PARTS_COLUMNS, PARTS_COLUMN_COUNT, error, sizeof(error)) != 0) {
+        printf("语句错误：%s\n", error);
+        return 1;
+    }
+    if (bench) return run_wal_bench();
+
+    if (reload || access(STORE_FILE_PATH, F_OK) != 0) {
+        start = bench_now();
+        unlink(WAL_FILE_PATH);  // 旧日志属于旧的页存储
+        if (page_store_create(STORE_FILE_PATH, INPUT_FILE_PATH) != 0) {
+            perror("无法建立页存储");
+            return 1;
+        }
+        end = bench_now();
+        printf("建立页存储 %s 完成 | 耗时：%.4f 秒\n", STORE_FILE_PATH, end - start);
+    }
+
+    if (open_store(&store, &wal, STORE_FILE_PATH, WAL_FILE_PATH, WAL_SYNC_GROUP) != 0) return 1;
+
+    start = bench_now();
+    int line_count = 0, modified_count = 0, result;
+    uint64_t lsn = 0;
+    char buffer[PAGE_SIZE];
+    StrView fields[PARTS_COLUMN_COUNT];
+    page_scan_init(&scan);
+    while ((result = page_scan_next(&store, &scan, &tuple)) > 0) {
+        line_count++;
+        if (!rewrite_row(&tuple, line_count, buffer, sizeof(buffer), fields)) continue;
+        lsn = log_and_update(&store, &wal, tuple.rid, fields, PARTS_COLUMN_COUNT, &tuple);
+        if (lsn == 0) {
+            result = -1;
+            break;
+        }
+        modified_count++;
+    }
+    if (result < 0 || (lsn != 0 && wal_commit(&wal) != 0)) {
+        perror("更新页存储失败");
+        close_store(&store, &wal);
+        return 1;
+    }
+    if (page_store_flush(&store) != 0) {
+        perror("写回页存储失败");
+        close_store(&store, &wal);
+        return 1;
+    }
+    end = bench_now();
+
+    printf("更新完成 | 总行数：%d | 修改行数：%d | 写回页数：%llu / %u | 写入字节：%llu / %llu | 耗时：%.4f 秒\n",
+           line_count, modified_count, (unsigned long long)store.pages_written, store.page_count - 1,
+           (unsigned long long)store.bytes_written, (unsigned long long)store.page_count * PAGE_SIZE,
+           end - start);
+
+    if (export_path) {
+        long rows = page_store_export_csv(&store, export_path);
+        if (rows < 0) {
+            perror("导出CSV失败");
+        } else {
+            printf("导出 %s 完成 | 行数：%ld\n", export_path, rows);
+        }
+    }
+
+    if (close_store(&store, &wal) != 0) {
+        perror("关闭页存储失败");
+        return 1;
+    }
+    return 0;
+}
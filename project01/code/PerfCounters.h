@@ -0,0 +1,116 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+// 硬件性能计数器：用perf_event_open统计周期数、指令数、L1数据缓存读缺失、末级缓存缺失、
+// 分支预测失败和缺页次数，用来区分慢在缓存缺失、分支预测还是指令本身太多。
+// 计数对象是整个进程：打开时设置inherit，之后创建的线程也计入（所以要在线程池创建之前打开），
+// 读取父线程的计数器时内核把各线程的计数加在一起。只统计用户态，普通用户在perf_event_paranoid=2时也能打开。
+// 每个事件单独打开：某个事件不支持或没有权限（虚拟机没有PMU、perf_event_paranoid=3、容器的seccomp）时
+// 只有它不可用；一个都打不开时perf_open返回-1，调用方照常运行，只是没有计数。非Linux平台上全部不可用。
+// 同时打开的事件多于硬件计数器时内核轮流计数，读数按 time_enabled / time_running 换算。
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+typedef enum {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_PAGE_FAULTS,
+    PERF_COUNTER_COUNT
+} PerfCounterId;
+
+static const char *const perf_counter_names[PERF_COUNTER_COUNT] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "page_faults"
+};
+
+typedef struct {
+    int fd[PERF_COUNTER_COUNT];  // 不可用的为-1
+    int available;               // 可用的计数器个数
+    int error;                   // 最后一个打不开的计数器的errno
+} PerfCounters;
+
+// 一次读数（从打开时起的累计值）
+typedef struct {
+    uint64_t value[PERF_COUNTER_COUNT];
+} PerfSample;
+
+#ifdef __linux__
+static inline int perf_open_event(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+#endif
+
+// 打开全部计数器，返回可用的个数；一个都没有时返回-1（error记下原因）
+static inline int perf_open(PerfCounters *perf) {
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) perf->fd[i] = -1;
+    perf->available = 0;
+    perf->error = ENOSYS;
+#ifdef __linux__
+    static const struct { uint32_t type; uint64_t config; } events[PERF_COUNTER_COUNT] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    };
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        perf->fd[i] = perf_open_event(events[i].type, events[i].config);
+        if (perf->fd[i] >= 0) {
+            perf->available++;
+        } else {
+            perf->error = errno;
+        }
+    }
+#endif
+    return perf->available > 0 ? perf->available : -1;
+}
+
+static inline int perf_has(const PerfCounters *perf, PerfCounterId id) {
+    return perf->fd[id] >= 0;
+}
+
+// 读出所有可用计数器的当前值，不可用的记0
+static inline void perf_read(const PerfCounters *perf, PerfSample *sample) {
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        sample->value[i] = 0;
+#ifdef __linux__
+        uint64_t data[3];  // 计数、time_enabled、time_running
+        if (perf->fd[i] < 0 || read(perf->fd[i], data, sizeof(data)) != (ssize_t)sizeof(data)) continue;
+        if (data[2] == 0) continue;  // 还没有轮到过
+        sample->value[i] = data[2] < data[1] ? (uint64_t)((double)data[0] * data[1] / data[2]) : data[0];
+#endif
+    }
+}
+
+static inline void perf_close(PerfCounters *perf) {
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+#ifdef __linux__
+        if (perf->fd[i] >= 0) close(perf->fd[i]);
+#endif
+        perf->fd[i] = -1;
+    }
+    perf->available = 0;
+}
+
+#endif
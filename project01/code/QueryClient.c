@@ -0,0 +1,149 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "QueryProtocol.h"
+#include "Bench.h"
+
+// 查询服务（QueryServer.c）的命令行客户端：发出一种查询，打印结果，或者重复多次统计往返延迟。
+// 用法：QueryClient [--socket 路径] [--runs N] [--warmup N] [--csv 文件] [--json 文件] 查询
+//   ping
+//   join [主题 颜色 起始年份 结束年份 数量下限 LIMIT]   默认 Castle Black 2000 2020 5 0
+//   spare [LIMIT]                                        空闲零件导出
+//   parts is_spare color_id 数量下限 LIMIT               is_spare、color_id为-1表示不限
+// 只运行一次时逐行打印结果（格式同RetrievalMultiple / RetrievalSingle的输出），多次时只打印每次的行数和耗时。
+// 计时阶段：query为往返时间（发出请求到收完应答），decode为解析应答
+
+typedef struct {
+    uint16_t type;
+    char body[QUERY_MAX_REQUEST];
+    uint32_t length;
+} Request;
+
+// 按命令行组装请求，参数不对返回-1
+static int build_request(Request *request, int argc, char **argv) {
+    QueryWriter writer;
+    query_writer_init(&writer, request->body, sizeof(request->body));
+    if (argc < 1) return -1;
+    const char *kind = argv[0];
+    if (strcmp(kind, "ping") == 0 && argc == 1) {
+        request->type = QUERY_PING;
+    } else if (strcmp(kind, "join") == 0 && (argc == 1 || argc == 7)) {
+        const char *theme = argc == 7 ? argv[1] : "Castle";
+        const char *color = argc == 7 ? argv[2] : "Black";
+        request->type = QUERY_JOIN;
+        query_put_i32(&writer, argc == 7 ? atoi(argv[3]) : 2000);
+        query_put_i32(&writer, argc == 7 ? atoi(argv[4]) : 2020);
+        query_put_i32(&writer, argc == 7 ? atoi(argv[5]) : 5);
+        query_put_i32(&writer, argc == 7 ? atoi(argv[6]) : 0);
+        query_put_str(&writer, theme, strlen(theme));
+        query_put_str(&writer, color, strlen(color));
+    } else if (strcmp(kind, "spare") == 0 && argc <= 2) {
+        request->type = QUERY_PARTS;
+        query_put_i32(&writer, 1);
+        query_put_i32(&writer, -1);
+        query_put_i32(&writer, 0);
+        query_put_i32(&writer, argc == 2 ? atoi(argv[1]) : 0);
+    } else if (strcmp(kind, "parts") == 0 && argc == 5) {
+        request->type = QUERY_PARTS;
+        for (int i = 1; i <= 4; i++) query_put_i32(&writer, atoi(argv[i]));
+    } else {
+        return -1;
+    }
+    if (writer.overflow) return -1;
+    request->length = (uint32_t)(writer.p - request->body);
+    return 0;
+}
+
+// 解析应答，print为1时逐行打印。返回行数，内容不完整返回-1
+static long decode_reply(uint16_t type, const char *body, uint32_t length, int print) {
+    QueryReader reader;
+    const char *s[4];
+    uint16_t n[4];
+    if (type == QUERY_PING) return 0;
+    query_reader_init(&reader, body, length);
+    uint32_t count = query_get_u32(&reader);
+    if (print && type == QUERY_JOIN) printf("套装编号,套装名称,发布年份,主题名称,零件编号,零件数量\n");
+    if (print && type == QUERY_PARTS) printf("inventory_id,part_num,color_id,quantity\n");
+    for (uint32_t r = 0; r < count && !reader.error; r++) {
+        if (type == QUERY_JOIN) {
+            n[0] = query_get_str(&reader, &s[0]);
+            n[1] = query_get_str(&reader, &s[1]);
+            int year = query_get_i32(&reader);
+            n[2] = query_get_str(&reader, &s[2]);
+            n[3] = query_get_str(&reader, &s[3]);
+            int quantity = query_get_i32(&reader);
+            if (print && !reader.error) {
+                printf("%.*s,%.*s,%d,%.*s,%.*s,%d\n", n[0], s[0], n[1], s[1], year, n[2], s[2], n[3], s[3], quantity);
+            }
+        } else {
+            int inventory_id = query_get_i32(&reader);
+            n[0] = query_get_str(&reader, &s[0]);
+            int color_id = query_get_i32(&reader);
+            int quantity = query_get_i32(&reader);
+            if (print && !reader.error) printf("%d,%.*s,%d,%d\n", inventory_id, n[0], s[0], color_id, quantity);
+        }
+    }
+    return reader.error ? -1 : (long)count;
+}
+
+int main(int argc, char *argv[]) {
+    const char *socket_path = QUERY_SOCKET_PATH;
+    Bench bench;
+    Request request;
+
+    bench_init(&bench, "QueryClient", 1, 0);
+    if (bench_parse_args(&bench, &argc, argv) != 0) return 1;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "--socket") == 0) {
+        socket_path = argv[2];
+        first = 3;
+    }
+    if (build_request(&request, argc - first, argv + first) != 0) {
+        printf("用法：%s [--socket 路径] [--runs N] [--warmup N] [--csv 文件] [--json 文件] "
+               "ping | join [主题 颜色 起始年份 结束年份 数量下限 LIMIT] | spare [LIMIT] | "
+               "parts is_spare color_id 数量下限 LIMIT\n", argv[0]);
+        return 1;
+    }
+
+    int fd = query_connect(socket_path);
+    if (fd < 0) {
+        printf("无法连接查询服务 %s：%s\n", socket_path, strerror(errno));
+        return 1;
+    }
+
+    int result = 0;
+    uint32_t id = 0;
+    while (bench_next_run(&bench)) {
+        QueryHeader reply;
+        char *body;
+        bench_phase(&bench, "query");
+        if (query_call(fd, request.type, ++id, request.body, request.length, &reply, &body) != 0) {
+            printf("查询失败：%s\n", strerror(errno));
+            bench_run_end(&bench, 0);
+            result = 1;
+            break;
+        }
+        bench_phase(&bench, "decode");
+        long rows = -1;
+        if (reply.status == QUERY_OK) {
+            rows = decode_reply(request.type, body, reply.length, bench.runs == 1);
+            if (rows < 0) printf("应答内容不完整\n");
+        } else {
+            printf("服务端错误（%u）：%s\n", reply.status, body);
+        }
+        free(body);
+        bench_run_end(&bench, rows >= 0);
+        if (rows < 0) {
+            result = 1;
+            break;
+        }
+        printf("结果：%ld 行 | 服务端执行：%.3f 毫秒 | 往返：%.3f 毫秒\n", rows, reply.elapsed_us / 1000.0,
+               bench_phase_time(&bench, "query") * 1000);
+    }
+    close(fd);
+    if (bench.runs > 1 || bench.csv_path || bench.json_path) bench_report(&bench);
+    bench_free(&bench);
+    return result;
+}
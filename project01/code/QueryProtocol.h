@@ -0,0 +1,229 @@
+#ifndef QUERY_PROTOCOL_H
+#define QUERY_PROTOCOL_H
+
+// 查询服务（QueryServer.c）的二进制协议。走Unix域套接字，客户端和服务在同一台机器上，整数一律按本机字节序。
+// 每条消息 = QueryHeader + length字节的内容；客户端可以连续发出多个请求，服务按顺序应答，id原样带回。
+//
+// 请求内容：
+//   QUERY_PING ：无
+//   QUERY_JOIN ：i32 起始年份, i32 结束年份, i32 零件数量下限, i32 limit（0表示全部）, str 主题名称, str 颜色名称
+//   QUERY_PARTS：i32 is_spare（-1不限，0/1）, i32 color_id（-1不限）, i32 零件数量下限, i32 limit（0表示全部）
+//                空闲零件导出即 is_spare=1、color_id=-1、下限0
+// 应答内容（status为QUERY_OK时）：u32 行数，之后逐行
+//   QUERY_JOIN ：str 套装编号, str 套装名称, i32 发布年份, str 主题名称, str 零件编号, i32 零件数量
+//   QUERY_PARTS：i32 inventory_id, str 零件编号, i32 color_id, i32 零件数量
+// status不是QUERY_OK时，内容是错误信息文本。str = u16长度 + 正文（不以'\0'结尾）。
+// 应答头的elapsed_us是服务端执行这个请求花的时间（微秒），不含排队和传输。
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define QUERY_SOCKET_PATH "/tmp/lego_query.sock"
+#define QUERY_MAX_REQUEST 4096            // 请求内容的最大长度
+#define QUERY_MAX_RESPONSE (256u << 20)   // 客户端接受的最大应答
+
+typedef enum {
+    QUERY_PING = 0,
+    QUERY_JOIN = 1,
+    QUERY_PARTS = 2
+} QueryType;
+
+typedef enum {
+    QUERY_OK = 0,
+    QUERY_BAD_REQUEST = 1,  // 类型未知或内容不完整
+    QUERY_FAILED = 2        // 执行失败（内存不足等）
+} QueryStatus;
+
+typedef struct {
+    uint32_t length;      // 内容字节数
+    uint16_t type;        // QueryType
+    uint16_t status;      // 请求中为0，应答中为QueryStatus
+    uint32_t id;          // 客户端自定的请求编号
+    uint32_t elapsed_us;  // 仅应答使用
+} QueryHeader;
+
+// ---------- 编码与解码 ----------
+
+// 往固定大小的缓冲区里顺序写，空间不够时置overflow，之后的写入都丢弃
+typedef struct {
+    char *p, *end;
+    int overflow;
+} QueryWriter;
+
+// 从一段内容里顺序读，内容不够时置error，之后读到的都是0或空串
+typedef struct {
+    const char *p, *end;
+    int error;
+} QueryReader;
+
+static inline void query_writer_init(QueryWriter *w, char *buf, size_t size) {
+    w->p = buf;
+    w->end = buf + size;
+    w->overflow = 0;
+}
+
+static inline void query_put(QueryWriter *w, const void *data, size_t len) {
+    if (w->overflow || (size_t)(w->end - w->p) < len) {
+        w->overflow = 1;
+        return;
+    }
+    memcpy(w->p, data, len);
+    w->p += len;
+}
+
+static inline void query_put_i32(QueryWriter *w, int32_t v) {
+    query_put(w, &v, sizeof(v));
+}
+
+static inline void query_put_u32(QueryWriter *w, uint32_t v) {
+    query_put(w, &v, sizeof(v));
+}
+
+// 字符串超过65535字节时截断
+static inline void query_put_str(QueryWriter *w, const char *s, size_t len) {
+    uint16_t n = (uint16_t)(len > 0xFFFF ? 0xFFFF : len);
+    query_put(w, &n, sizeof(n));
+    query_put(w, s, n);
+}
+
+// 一个str编码后的长度
+static inline size_t query_str_size(size_t len) {
+    return sizeof(uint16_t) + (len > 0xFFFF ? 0xFFFF : len);
+}
+
+static inline void query_reader_init(QueryReader *r, const char *data, size_t len) {
+    r->p = data;
+    r->end = data + len;
+    r->error = 0;
+}
+
+static inline int query_get(QueryReader *r, void *out, size_t len) {
+    if (r->error || (size_t)(r->end - r->p) < len) {
+        r->error = 1;
+        memset(out, 0, len);
+        return -1;
+    }
+    memcpy(out, r->p, len);
+    r->p += len;
+    return 0;
+}
+
+static inline int32_t query_get_i32(QueryReader *r) {
+    int32_t v;
+    query_get(r, &v, sizeof(v));
+    return v;
+}
+
+static inline uint32_t query_get_u32(QueryReader *r) {
+    uint32_t v;
+    query_get(r, &v, sizeof(v));
+    return v;
+}
+
+// 取一个str，*ptr指向内容里的正文
+static inline uint16_t query_get_str(QueryReader *r, const char **ptr) {
+    uint16_t n;
+    *ptr = "";
+    if (query_get(r, &n, sizeof(n)) != 0) return 0;
+    if ((size_t)(r->end - r->p) < n) {
+        r->error = 1;
+        return 0;
+    }
+    *ptr = r->p;
+    r->p += n;
+    return n;
+}
+
+// ---------- 套接字收发 ----------
+
+// 写完len字节（被信号打断时继续；对端已关闭时返回-1而不是收到SIGPIPE）
+static inline int query_send_all(int fd, const void *data, size_t len) {
+    const char *p = (const char*)data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// 读满len字节，对端关闭或出错返回-1
+static inline int query_recv_all(int fd, void *data, size_t len) {
+    char *p = (char*)data;
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (n == 0) errno = ECONNRESET;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// 发出一条消息（头和内容合在一次发送里）
+static inline int query_send(int fd, const QueryHeader *header, const void *body) {
+    char frame[sizeof(QueryHeader) + QUERY_MAX_REQUEST];
+    if (header->length <= QUERY_MAX_REQUEST) {
+        memcpy(frame, header, sizeof(QueryHeader));
+        memcpy(frame + sizeof(QueryHeader), body, header->length);
+        return query_send_all(fd, frame, sizeof(QueryHeader) + header->length);
+    }
+    if (query_send_all(fd, header, sizeof(QueryHeader)) != 0) return -1;
+    return query_send_all(fd, body, header->length);
+}
+
+// 连接查询服务，失败返回-1
+static inline int query_connect(const char *path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+// 发出请求并等待应答。应答内容放在*body（malloc分配，由调用方free；内容为空时也会分配）。
+// 通信失败返回-1；服务端返回错误时仍返回0，由reply->status区分
+static inline int query_call(int fd, uint16_t type, uint32_t id, const void *request, uint32_t length,
+                             QueryHeader *reply, char **body) {
+    QueryHeader header = { length, type, 0, id, 0 };
+    *body = NULL;
+    if (query_send(fd, &header, request) != 0) return -1;
+    if (query_recv_all(fd, reply, sizeof(*reply)) != 0) return -1;
+    if (reply->length > QUERY_MAX_RESPONSE || reply->id != id) {
+        errno = EPROTO;
+        return -1;
+    }
+    *body = (char*)malloc(reply->length + 1);
+    if (!*body) return -1;
+    if (query_recv_all(fd, *body, reply->length) != 0) {
+        free(*body);
+        *body = NULL;
+        return -1;
+    }
+    (*body)[reply->length] = '\0';
+    return 0;
+}
+
+#endif
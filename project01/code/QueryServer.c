@@ -0,0 +1,421 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "LegoJoin.h"
+#include "QueryProtocol.h"
+
+// 常驻查询服务：启动时把五张表读进内存（LegoJoin.h的loadTables：列存布局、字符串驻留为字典编码），
+// 之后一直保留，通过Unix域套接字接收查询（协议见QueryProtocol.h），每次查询只剩建索引、探测和排序的开销。
+// 主线程用poll管理所有连接，收齐一个请求就交给工作线程池执行；执行期间不再读这个连接，
+// 所以同一连接的应答按请求顺序发出、不会交错。工作线程发完应答后通过管道唤醒主线程，继续处理这个连接后面的请求。
+// 各表只读，多个查询并发执行，每个查询的中间结构和应答都放在自己的Arena里。
+// 用法：QueryServer [--socket 路径] [--workers N]，Ctrl+C或SIGTERM退出
+
+#define MAX_CLIENTS 1024
+#define NAME_MAX_LENGTH 256  // 主题、颜色名称的最大长度（含'\0'）
+
+typedef struct {
+    int fd;                 // -1表示空位
+    char buffer[sizeof(QueryHeader) + QUERY_MAX_REQUEST];  // 已收到、还没处理的字节
+    size_t length;
+    int busy;               // 有请求在线程池里执行（主线程置1，工作线程置0）
+    int broken;             // 发送应答失败，由主线程关闭
+} Client;
+
+typedef struct {
+    Client *client;
+    QueryHeader header;
+    char body[QUERY_MAX_REQUEST];
+} Job;
+
+static TableLoad tables;
+static Client clients[MAX_CLIENTS];
+static int wake_pipe[2] = { -1, -1 };
+static volatile sig_atomic_t stopping = 0;
+static uint64_t query_count, query_total_us;  // 工作线程用__atomic累加
+
+static void on_signal(int sig) {
+    (void)sig;
+    stopping = 1;
+    if (write(wake_pipe[1], "x", 1) < 0) {
+        // 管道满时主线程反正会被唤醒
+    }
+}
+
+// 应答缓冲区开头留出QueryHeader，填好头后一次发出
+static void send_reply(Job *job, uint16_t status, char *frame, uint32_t length, double start) {
+    uint32_t elapsed_us = (uint32_t)((bench_now() - start) * 1e6);
+    QueryHeader header = { length, job->header.type, status, job->header.id, elapsed_us };
+    memcpy(frame, &header, sizeof(header));
+    if (query_send_all(job->client->fd, frame, sizeof(header) + length) != 0) {
+        __atomic_store_n(&job->client->broken, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&query_count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&query_total_us, elapsed_us, __ATOMIC_RELAXED);
+}
+
+static void send_error(Job *job, uint16_t status, const char *message, double start) {
+    char frame[sizeof(QueryHeader) + 256];
+    size_t len = strlen(message);
+    if (len > sizeof(frame) - sizeof(QueryHeader)) len = sizeof(frame) - sizeof(QueryHeader);
+    memcpy(frame + sizeof(QueryHeader), message, len);
+    send_reply(job, status, frame, (uint32_t)len, start);
+}
+
+// 取一个名称并补上'\0'，太长返回-1
+static int read_name(QueryReader *reader, char *name) {
+    const char *ptr;
+    uint16_t len = query_get_str(reader, &ptr);
+    if (reader->error || len >= NAME_MAX_LENGTH) return -1;
+    memcpy(name, ptr, len);
+    name[len] = '\0';
+    return 0;
+}
+
+static void run_join(Job *job, Arena *arena, double start) {
+    QueryReader reader;
+    JoinQuery query;
+    char theme[NAME_MAX_LENGTH], color[NAME_MAX_LENGTH];
+
+    query_reader_init(&reader, job->body, job->header.length);
+    query.yearFrom = query_get_i32(&reader);
+    query.yearTo = query_get_i32(&reader);
+    query.minQuantity = query_get_i32(&reader);
+    query.limit = query_get_i32(&reader);
+    if (read_name(&reader, theme) != 0 || read_name(&reader, color) != 0 || query.limit < 0) {
+        send_error(job, QUERY_BAD_REQUEST, "关联查询参数不完整", start);
+        return;
+    }
+    query.themeName = theme;
+    query.colorName = color;
+
+    int count = 0;
+    Result *results = multiTableJoinQuery(&tables.sets, &tables.themes, &tables.inventories,
+                                          &tables.inventoryParts, &tables.colors, &query, arena, &count);
+    if (!results) {
+        send_error(job, QUERY_FAILED, "关联查询执行失败", start);
+        return;
+    }
+
+    // 先算出应答长度，一次分配
+    size_t size = sizeof(uint32_t);
+    for (int i = 0; i < count; i++) {
+        size += query_str_size(str_dict_get(results[i].set_num).len) +
+                query_str_size(str_dict_get(results[i].set_name).len) +
+                query_str_size(str_dict_get(results[i].theme_name).len) +
+                query_str_size(str_dict_get(results[i].part_id).len) + 2 * sizeof(int32_t);
+    }
+    char *frame = (char*)arena_alloc(arena, sizeof(QueryHeader) + size);
+    if (!frame || size > UINT32_MAX) {
+        send_error(job, QUERY_FAILED, "应答内存分配失败", start);
+        return;
+    }
+    QueryWriter writer;
+    query_writer_init(&writer, frame + sizeof(QueryHeader), size);
+    query_put_u32(&writer, (uint32_t)count);
+    for (int i = 0; i < count; i++) {
+        StrView setNum = str_dict_get(results[i].set_num);
+        StrView setName = str_dict_get(results[i].set_name);
+        StrView themeName = str_dict_get(results[i].theme_name);
+        StrView partId = str_dict_get(results[i].part_id);
+        query_put_str(&writer, setNum.ptr, setNum.len);
+        query_put_str(&writer, setName.ptr, setName.len);
+        query_put_i32(&writer, results[i].publish_year);
+        query_put_str(&writer, themeName.ptr, themeName.len);
+        query_put_str(&writer, partId.ptr, partId.len);
+        query_put_i32(&writer, results[i].inventory_quantity);
+    }
+    send_reply(job, QUERY_OK, frame, (uint32_t)size, start);
+}
+
+// 按条件过滤inventory_parts（见LegoJoin.h的filterParts），结果按原表顺序
+static void run_parts(Job *job, Arena *arena, double start) {
+    const InventoryPartTable *parts = &tables.inventoryParts;
+    QueryReader reader;
+    query_reader_init(&reader, job->body, job->header.length);
+    int spare = query_get_i32(&reader);
+    int color_id = query_get_i32(&reader);
+    int min_quantity = query_get_i32(&reader);
+    int limit = query_get_i32(&reader);
+    if (reader.error || spare < -1 || spare > 1 || limit < 0) {
+        send_error(job, QUERY_BAD_REQUEST, "零件过滤参数不合法", start);
+        return;
+    }
+
+    // 过滤只读条件用到的列，命中的行号记下来，再算应答长度
+    int *rows = (int*)arena_alloc(arena, (parts->count > 0 ? parts->count : 1) * sizeof(int));
+    if (!rows) {
+        send_error(job, QUERY_FAILED, "结果集内存分配失败", start);
+        return;
+    }
+    int count = filterParts(parts, spare, color_id, min_quantity, limit, rows);
+    size_t size = sizeof(uint32_t);
+    for (int r = 0; r < count; r++) {
+        size += 3 * sizeof(int32_t) + query_str_size(str_dict_get(parts->part_num[rows[r]]).len);
+    }
+
+    char *frame = (char*)arena_alloc(arena, sizeof(QueryHeader) + size);
+    if (!frame || size > UINT32_MAX) {
+        send_error(job, QUERY_FAILED, "应答内存分配失败", start);
+        return;
+    }
+    QueryWriter writer;
+    query_writer_init(&writer, frame + sizeof(QueryHeader), size);
+    query_put_u32(&writer, (uint32_t)count);
+    for (int r = 0; r < count; r++) {
+        int i = rows[r];
+        StrView part_num = str_dict_get(parts->part_num[i]);
+        query_put_i32(&writer, parts->inventory_id[i]);
+        query_put_str(&writer, part_num.ptr, part_num.len);
+        query_put_i32(&writer, parts->color_id[i]);
+        query_put_i32(&writer, parts->quantity[i]);
+    }
+    send_reply(job, QUERY_OK, frame, (uint32_t)size, start);
+}
+
+// 工作线程：执行一个请求并发出应答，然后把连接交还主线程
+static void run_job(void *arg) {
+    Job *job = (Job*)arg;
+    Client *client = job->client;
+    double start = bench_now();
+    Arena arena;
+    arena_init(&arena);
+
+    if (job->header.type == QUERY_JOIN) {
+        run_join(job, &arena, start);
+    } else if (job->header.type == QUERY_PARTS) {
+        run_parts(job, &arena, start);
+    } else if (job->header.type == QUERY_PING) {
+        char frame[sizeof(QueryHeader)];
+        send_reply(job, QUERY_OK, frame, 0, start);
+    } else {
+        send_error(job, QUERY_BAD_REQUEST, "未知的请求类型", start);
+    }
+
+    arena_release(&arena);
+    free(job);
+    __atomic_store_n(&client->busy, 0, __ATOMIC_RELEASE);
+    if (write(wake_pipe[1], "x", 1) < 0) {
+        // 管道满说明主线程已经有待处理的唤醒
+    }
+}
+
+static void close_client(Client *client) {
+    close(client->fd);
+    client->fd = -1;
+    client->length = 0;
+    client->broken = 0;
+}
+
+// 缓冲区里有完整的请求且连接空闲时，交给线程池。请求过长时关闭连接（无法再对齐消息边界）
+static void dispatch(ThreadPool *pool, TaskGroup *group, Client *client) {
+    if (client->fd < 0 || __atomic_load_n(&client->busy, __ATOMIC_ACQUIRE)) return;
+    if (client->broken) {
+        close_client(client);
+        return;
+    }
+    if (client->length < sizeof(QueryHeader)) return;
+    QueryHeader header;
+    memcpy(&header, client->buffer, sizeof(header));
+    if (header.length > QUERY_MAX_REQUEST) {
+        printf("请求过长（%u 字节），关闭连接\n", header.length);
+        close_client(client);
+        return;
+    }
+    size_t frame = sizeof(QueryHeader) + header.length;
+    if (client->length < frame) return;
+
+    Job *job = (Job*)malloc(sizeof(Job));
+    if (!job) {
+        close_client(client);
+        return;
+    }
+    job->client = client;
+    job->header = header;
+    memcpy(job->body, client->buffer + sizeof(QueryHeader), header.length);
+    client->length -= frame;
+    memmove(client->buffer, client->buffer + frame, client->length);
+    client->busy = 1;
+    thread_pool_submit(pool, group, run_job, job);
+}
+
+static int open_listener(const char *path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);  // 上次异常退出留下的套接字文件
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 128) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+static void accept_clients(int listener) {
+    for (;;) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) return;  // EAGAIN：已经取完
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        int slot = 0;
+        while (slot < MAX_CLIENTS && clients[slot].fd >= 0) slot++;
+        if (slot == MAX_CLIENTS) {
+            printf("连接数已达上限 %d，拒绝新连接\n", MAX_CLIENTS);
+            close(fd);
+            continue;
+        }
+        clients[slot].fd = fd;
+        clients[slot].length = 0;
+        clients[slot].busy = 0;
+        clients[slot].broken = 0;
+    }
+}
+
+// 读取一个连接的数据，对端关闭或出错时关闭连接
+static void read_client(Client *client) {
+    size_t space = sizeof(client->buffer) - client->length;
+    ssize_t n = recv(client->fd, client->buffer + client->length, space, MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return;
+    if (n <= 0) {
+        close_client(client);
+        return;
+    }
+    client->length += (size_t)n;
+}
+
+static int serve(int listener, ThreadPool *pool) {
+    static struct pollfd fds[MAX_CLIENTS + 2];
+    static int slot_of[MAX_CLIENTS + 2];
+    TaskGroup group = {0};
+
+    fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+    while (!stopping) {
+        int count = 0;
+        fds[count].fd = listener;
+        fds[count++].events = POLLIN;
+        fds[count].fd = wake_pipe[0];
+        fds[count++].events = POLLIN;
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            // 执行中的连接和缓冲区已满的连接暂不读取
+            if (clients[i].fd < 0 || __atomic_load_n(&clients[i].busy, __ATOMIC_ACQUIRE) ||
+                clients[i].length == sizeof(clients[i].buffer)) continue;
+            fds[count].fd = clients[i].fd;
+            fds[count].events = POLLIN;
+            slot_of[count++] = i;
+        }
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("poll失败");
+            break;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            char drain[256];
+            while (read(wake_pipe[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+        if (fds[0].revents & POLLIN) accept_clients(listener);
+        for (int k = 2; k < count; k++) {
+            if (fds[k].revents) read_client(&clients[slot_of[k]]);
+        }
+        // 新收到的数据，以及刚执行完的连接缓冲区里剩下的请求
+        for (int i = 0; i < MAX_CLIENTS; i++) dispatch(pool, &group, &clients[i]);
+    }
+
+    task_group_wait(pool, &group);
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0) close_client(&clients[i]);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *socket_path = QUERY_SOCKET_PATH;
+    int workers = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else {
+            printf("用法：%s [--socket 路径] [--workers N]\n", argv[0]);
+            return 1;
+        }
+    }
+    for (int i = 0; i < MAX_CLIENTS; i++) clients[i].fd = -1;
+
+    // 启动中途失败和正常退出都走到cleanup，按创建的逆序释放已经建立的资源
+    int result = 1;
+    ThreadPool *pool = NULL;
+    int listener = -1;
+    double start = bench_now();
+    if (loadTables(&tables) != 0) {
+        printf("文件读取失败，服务无法启动\n");
+        goto cleanup;
+    }
+    printf("五张表读取完成 | inventory_parts：%d 行 | 耗时：%.2f 毫秒\n",
+           tables.inventoryParts.count, (bench_now() - start) * 1000);
+
+    pool = thread_pool_create(workers);
+    if (!pool) {
+        printf("工作线程池创建失败\n");
+        goto cleanup;
+    }
+    if (pipe(wake_pipe) != 0) {
+        perror("无法创建唤醒管道");
+        goto cleanup;
+    }
+    fcntl(wake_pipe[0], F_SETFL, fcntl(wake_pipe[0], F_GETFL) | O_NONBLOCK);
+    fcntl(wake_pipe[1], F_SETFL, fcntl(wake_pipe[1], F_GETFL) | O_NONBLOCK);
+
+    listener = open_listener(socket_path);
+    if (listener < 0) {
+        printf("无法监听 %s：%s\n", socket_path, strerror(errno));
+        goto cleanup;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    printf("查询服务已启动 | 套接字：%s | 工作线程：%d\n", socket_path, pool->thread_count);
+    fflush(stdout);
+
+    serve(listener, pool);
+    result = 0;
+
+cleanup:
+    if (listener >= 0) {
+        close(listener);
+        unlink(socket_path);
+    }
+    // 工作线程完成任务时会写唤醒管道，线程池停下之后才能关闭它
+    if (pool) thread_pool_destroy(pool);
+    for (int i = 0; i < 2; i++) {
+        if (wake_pipe[i] >= 0) close(wake_pipe[i]);
+        wake_pipe[i] = -1;
+    }
+    freeTables(&tables);
+    str_dict_release();
+    if (result == 0) {
+        uint64_t count = __atomic_load_n(&query_count, __ATOMIC_RELAXED);
+        printf("查询服务已退出 | 处理请求：%llu 次 | 平均执行时间：%.3f 毫秒\n", (unsigned long long)count,
+               count ? __atomic_load_n(&query_total_us, __ATOMIC_RELAXED) / 1000.0 / count : 0.0);
+    }
+    return result;
+}
@@ -0,0 +1,68 @@
+#ifndef RECORD_DIGEST_H
+#define RECORD_DIGEST_H
+
+// 与顺序无关的多重集摘要：每条记录算一个128位哈希，全部按128位整数相加（模2^128），
+// 同时记录条数。两份数据的记录多重集相同（顺序可以不同，重复次数也要相同）时摘要必然相同；
+// 不同时摘要相同的概率约为2^-128量级，可以只在摘要不同时再做逐条比较。
+// 流式累加，内存占用与数据量无关。
+
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+    uint64_t lo, hi;   // 128位累加和
+    uint64_t count;    // 记录条数（含重复）
+} RecordDigest;
+
+static inline uint64_t record_digest_mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// 两条独立的64位通道，结尾再互相混合，得到128位哈希
+static inline void record_hash128(const char *p, size_t len, uint64_t *lo, uint64_t *hi) {
+    uint64_t a = 0x9E3779B97F4A7C15ULL ^ (uint64_t)len;
+    uint64_t b = 0xD6E8FEB86659FD93ULL ^ ((uint64_t)len * 0xA0761D6478BD642FULL);
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        a = (a ^ v) * 0x87C37B91114253D5ULL;
+        a = (a << 31) | (a >> 33);
+        b = (b + v) * 0x4CF5AD432745937FULL;
+        b ^= b >> 29;
+        p += 8;
+        len -= 8;
+    }
+    uint64_t v = 0;
+    memcpy(&v, p, len);
+    a = (a ^ v) * 0x87C37B91114253D5ULL;
+    b = (b + v) * 0x4CF5AD432745937FULL;
+    a = record_digest_mix(a);
+    b = record_digest_mix(b ^ (a >> 1));
+    a += b;
+    *lo = a;
+    *hi = b;
+}
+
+static inline void record_digest_init(RecordDigest *digest) {
+    memset(digest, 0, sizeof(*digest));
+}
+
+static inline void record_digest_add(RecordDigest *digest, const char *record, size_t len) {
+    uint64_t lo, hi;
+    record_hash128(record, len, &lo, &hi);
+    uint64_t sum = digest->lo + lo;
+    digest->hi += hi + (sum < lo);  // 低64位的进位
+    digest->lo = sum;
+    digest->count++;
+}
+
+static inline int record_digest_equal(const RecordDigest *a, const RecordDigest *b) {
+    return a->lo == b->lo && a->hi == b->hi && a->count == b->count;
+}
+
+#endif
@@ -0,0 +1,277 @@
+#ifndef RECORD_SET_H
+#define RECORD_SET_H
+
+// 记录集合（去重的键集合，键是任意字节串），开放寻址、按Swiss表的方式组织：
+//   ctrl：每个槽一个控制字节，空槽为0x80，占用的槽存哈希最高7位；一次比较8个控制字节，
+//         只有7位标签相同的槽才去看完整的64位哈希，哈希也相同才比较正文；
+//   slots：槽里存64位哈希、键长和条目编号，扩容时不用重新计算哈希；
+//   entries：条目按插入顺序紧凑存放，编号0..count-1，记录正文位置和插入次数；
+//   bytes：所有键的正文按插入顺序连续存放（每个后面补'\0'，字符串键可以直接当C串用）。
+// 条目编号插入后不再变化，可以直接当数组下标用（关联时按键分组、去重时计数等）；
+// 计数和遍历只看count个条目，与槽数无关。负载超过7/8时槽数翻倍。不支持删除。
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORD_GROUP 8          // 每组8个控制字节
+#define RECORD_CTRL_EMPTY 0x80
+#define RECORD_MIN_CAPACITY 16
+#define RECORD_NONE UINT32_MAX  // 不存在的条目编号
+
+typedef struct {
+    uint64_t hash;    // 完整的64位哈希
+    uint32_t entry;   // 条目编号
+    uint32_t len;     // 键长，比较正文前先比长度
+} RecordSlot;
+
+typedef struct {
+    uint32_t offset;  // 正文在bytes中的起点
+    uint32_t len;     // 正文长度（不含'\0'）
+    uint32_t count;   // 插入次数（重复插入时累加）
+} RecordEntry;
+
+typedef struct {
+    uint8_t *ctrl;         // capacity + RECORD_GROUP 个，末尾8个是开头8个的镜像，便于跨尾部整组读取
+    RecordSlot *slots;
+    size_t capacity;       // 槽数（2的幂）
+    RecordEntry *entries;  // 按插入顺序
+    uint32_t count;        // 条目数（不同键的个数）
+    uint32_t entry_cap;
+    char *bytes;
+    size_t bytes_len, bytes_cap;
+} RecordSet;
+
+static inline uint64_t record_hash(const char *p, size_t len) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ (uint64_t)len;
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        h = (h ^ v) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 32;
+        p += 8;
+        len -= 8;
+    }
+    uint64_t v = 0;
+    memcpy(&v, p, len);
+    h = (h ^ v) * 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// 控制字节标签取哈希的最高7位，槽位置取低位，两者互不相关
+static inline uint8_t record_tag(uint64_t hash) {
+    return (uint8_t)(hash >> 57);
+}
+
+static inline uint64_t record_group_load(const uint8_t *ctrl) {
+    uint64_t group;
+    memcpy(&group, ctrl, 8);
+    return group;
+}
+
+// 组内控制字节等于tag的位置（每个命中字节的最高位为1，可能有误报，调用方再比哈希）
+static inline uint64_t record_group_match(uint64_t group, uint8_t tag) {
+    uint64_t x = group ^ (0x0101010101010101ULL * tag);
+    return (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+}
+
+static inline uint64_t record_group_empty(uint64_t group) {
+    return group & 0x8080808080808080ULL;
+}
+
+static inline void record_set_ctrl(RecordSet *set, size_t i, uint8_t tag) {
+    set->ctrl[i] = tag;
+    if (i < RECORD_GROUP) set->ctrl[set->capacity + i] = tag;
+}
+
+// 找到hash对应的第一个空槽（扩容重排和插入共用）
+static inline size_t record_find_empty(const RecordSet *set, uint64_t hash) {
+    size_t mask = set->capacity - 1;
+    size_t pos = (size_t)hash & mask;
+    for (;;) {
+        uint64_t empty = record_group_empty(record_group_load(set->ctrl + pos));
+        if (empty) return (pos + (size_t)(__builtin_ctzll(empty) >> 3)) & mask;
+        pos = (pos + RECORD_GROUP) & mask;
+    }
+}
+
+static inline int record_set_alloc_table(RecordSet *set, size_t capacity) {
+    set->ctrl = (uint8_t*)malloc(capacity + RECORD_GROUP);
+    set->slots = (RecordSlot*)malloc(capacity * sizeof(RecordSlot));
+    if (!set->ctrl || !set->slots) {
+        free(set->ctrl);
+        free(set->slots);
+        set->ctrl = NULL;
+        set->slots = NULL;
+        return -1;
+    }
+    memset(set->ctrl, RECORD_CTRL_EMPTY, capacity + RECORD_GROUP);
+    set->capacity = capacity;
+    return 0;
+}
+
+// 清空记录，保留已分配的内存供下一次加载复用
+static inline void record_set_clear(RecordSet *set) {
+    if (set->ctrl) memset(set->ctrl, RECORD_CTRL_EMPTY, set->capacity + RECORD_GROUP);
+    set->count = 0;
+    set->bytes_len = 0;
+}
+
+static inline void record_set_free(RecordSet *set) {
+    free(set->ctrl);
+    free(set->slots);
+    free(set->entries);
+    free(set->bytes);
+    memset(set, 0, sizeof(*set));
+}
+
+static inline int record_set_grow(RecordSet *set) {
+    RecordSet old = *set;
+    if (record_set_alloc_table(set, old.capacity * 2) != 0) {
+        *set = old;
+        return -1;
+    }
+    for (size_t i = 0; i < old.capacity; i++) {
+        if (old.ctrl[i] & RECORD_CTRL_EMPTY) continue;
+        size_t j = record_find_empty(set, old.slots[i].hash);
+        record_set_ctrl(set, j, old.ctrl[i]);
+        set->slots[j] = old.slots[i];
+    }
+    free(old.ctrl);
+    free(old.slots);
+    return 0;
+}
+
+static inline int record_set_reserve_entries(RecordSet *set, size_t entry_cap) {
+    if (entry_cap <= set->entry_cap) return 0;
+    if (entry_cap > RECORD_NONE) return -1;
+    RecordEntry *entries = (RecordEntry*)realloc(set->entries, entry_cap * sizeof(RecordEntry));
+    if (!entries) return -1;
+    set->entries = entries;
+    set->entry_cap = (uint32_t)entry_cap;
+    return 0;
+}
+
+// 保证能放下expected_count个键、共expected_bytes字节（含每个的'\0'）的正文而不必中途扩容，
+// 可按文件大小等估算后在加载前调用；全0的空集合也可以直接调用。失败返回-1
+static inline int record_set_reserve(RecordSet *set, size_t expected_count, size_t expected_bytes) {
+    size_t capacity = set->capacity ? set->capacity : RECORD_MIN_CAPACITY;
+    while (capacity / 8 * 7 < expected_count) capacity <<= 1;
+    if (!set->ctrl) {
+        if (record_set_alloc_table(set, capacity) != 0) return -1;
+    } else {
+        while (set->capacity < capacity) {
+            if (record_set_grow(set) != 0) return -1;
+        }
+    }
+    if (record_set_reserve_entries(set, expected_count > 16 ? expected_count : 16) != 0) return -1;
+    if (expected_bytes < 64) expected_bytes = 64;
+    if (expected_bytes > UINT32_MAX) expected_bytes = UINT32_MAX;
+    if (set->bytes_cap < expected_bytes) {
+        char *bytes = (char*)realloc(set->bytes, expected_bytes);
+        if (!bytes) return -1;
+        set->bytes = bytes;
+        set->bytes_cap = expected_bytes;
+    }
+    return 0;
+}
+
+static inline int record_set_init(RecordSet *set, size_t expected_count, size_t expected_bytes) {
+    memset(set, 0, sizeof(*set));
+    return record_set_reserve(set, expected_count, expected_bytes);
+}
+
+// 条目的正文（以'\0'结尾），len可为NULL
+static inline const char* record_set_key(const RecordSet *set, uint32_t entry, size_t *len) {
+    if (len) *len = set->entries[entry].len;
+    return set->bytes + set->entries[entry].offset;
+}
+
+static inline uint32_t record_set_find(const RecordSet *set, const char *key, size_t len, uint64_t hash) {
+    if (!set->ctrl) return RECORD_NONE;
+    size_t mask = set->capacity - 1;
+    size_t pos = (size_t)hash & mask;
+    uint8_t tag = record_tag(hash);
+    for (;;) {
+        uint64_t group = record_group_load(set->ctrl + pos);
+        for (uint64_t m = record_group_match(group, tag); m; m &= m - 1) {
+            const RecordSlot *slot = &set->slots[(pos + (size_t)(__builtin_ctzll(m) >> 3)) & mask];
+            if (slot->hash == hash && slot->len == len &&
+                memcmp(set->bytes + set->entries[slot->entry].offset, key, len) == 0) {
+                return slot->entry;
+            }
+        }
+        if (record_group_empty(group)) return RECORD_NONE;
+        pos = (pos + RECORD_GROUP) & mask;
+    }
+}
+
+// 查找键的条目编号，不存在返回RECORD_NONE
+static inline uint32_t record_set_lookup(const RecordSet *set, const char *key, size_t len) {
+    return record_set_find(set, key, len, record_hash(key, len));
+}
+
+static inline int record_set_contains(const RecordSet *set, const char *key, size_t len) {
+    return record_set_lookup(set, key, len) != RECORD_NONE;
+}
+
+// 键被插入的次数，不存在返回0
+static inline uint32_t record_set_count(const RecordSet *set, const char *key, size_t len) {
+    uint32_t entry = record_set_lookup(set, key, len);
+    return entry != RECORD_NONE ? set->entries[entry].count : 0;
+}
+
+// 插入键并返回条目编号（已存在时只累加次数），is_new可为NULL；内存不足返回RECORD_NONE
+static inline uint32_t record_set_add(RecordSet *set, const char *key, size_t len, int *is_new) {
+    uint64_t hash = record_hash(key, len);
+    uint32_t entry = record_set_find(set, key, len, hash);
+    if (is_new) *is_new = (entry == RECORD_NONE);
+    if (entry != RECORD_NONE) {
+        set->entries[entry].count++;
+        return entry;
+    }
+
+    if (!set->ctrl && record_set_reserve(set, 0, 0) != 0) return RECORD_NONE;
+    if (set->bytes_len + len + 1 > UINT32_MAX) return RECORD_NONE;  // 偏移量只有32位
+    if ((size_t)set->count + 1 > set->capacity / 8 * 7 && record_set_grow(set) != 0) return RECORD_NONE;
+    if (set->count == set->entry_cap &&
+        record_set_reserve_entries(set, (size_t)set->entry_cap * 2) != 0) {
+        return RECORD_NONE;
+    }
+    if (set->bytes_len + len + 1 > set->bytes_cap) {
+        size_t cap = set->bytes_cap * 2;
+        while (cap < set->bytes_len + len + 1) cap *= 2;
+        char *bytes = (char*)realloc(set->bytes, cap);
+        if (!bytes) return RECORD_NONE;
+        set->bytes = bytes;
+        set->bytes_cap = cap;
+    }
+
+    entry = set->count++;
+    RecordEntry *e = &set->entries[entry];
+    e->offset = (uint32_t)set->bytes_len;
+    e->len = (uint32_t)len;
+    e->count = 1;
+    memcpy(set->bytes + set->bytes_len, key, len);
+    set->bytes[set->bytes_len + len] = '\0';
+    set->bytes_len += len + 1;
+
+    size_t i = record_find_empty(set, hash);
+    record_set_ctrl(set, i, record_tag(hash));
+    set->slots[i].hash = hash;
+    set->slots[i].entry = entry;
+    set->slots[i].len = (uint32_t)len;
+    return entry;
+}
+
+// 插入记录：新插入返回1，已存在返回0（只累加次数），内存不足返回-1
+static inline int record_set_insert(RecordSet *set, const char *key, size_t len) {
+    int is_new;
+    if (record_set_add(set, key, len, &is_new) == RECORD_NONE) return -1;
+    return is_new;
+}
+
+#endif
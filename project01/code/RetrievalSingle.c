@@ -1,196 +1,113 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
-#include <time.h>
-
-typedef struct {
-    int inventory_id;
-    char part_num[50];
-    int color_id;
-    int quantity;
-    char is_spare;
-} InventoryPart;
-
-void trim(char* str) {
-    if (str == NULL || *str == '\0') return;
-    int len = strlen(str);
-    int start = 0, end = len - 1;
-
-    while (start <= end && (isspace((unsigned char)str[start]) || str[start] == '"')) {
-        start++;
-    }
-    while (end >= start && (isspace((unsigned char)str[end]) || str[end] == '"')) {
-        end--;
-    }
+#include "LegoTables.h"
+#include "OutWriter.h"
+#include "Bench.h"
 
-    if (start > end) {
-        str[0] = '\0';
-    } else {
-        memmove(str, str + start, end - start + 1);
-        str[end - start + 1] = '\0';
-    }
-}
+#define INVENTORY_PARTS_PATH "D:\\SQLlab\\lego\\data\\inventory_parts.csv"
 
-int read_inventory_from_csv(const char* filename, InventoryPart**parts, int* capacity, double* read_time) {
-    clock_t start = clock();
-
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        perror("无法打开inventory_parts.csv文件");
-        *read_time = 0;
-        return -1;
-    }
+// inventory_parts表的列存结构见LegoTables.h
 
-    *capacity = 100;
-    *parts = (InventoryPart*)malloc(*capacity * sizeof(InventoryPart));
-    if (!*parts) {
-        perror("内存分配失败");
-        fclose(file);
-        *read_time = 0;
+int read_inventory_from_csv(const char* filename, InventoryPartTable* parts) {
+    // 优先映射列存快照，快照不可用时多线程解析CSV
+    int count = load_inventory_part_table(parts, filename);
+    if (count < 0) {
+        perror("无法读取inventory_parts.csv文件");
         return -1;
     }
-
-    char line[1024];
-    int count = 0;
-    if (fgets(line, sizeof(line), file) == NULL) {
+    if (count == 0) {
         fprintf(stderr, "CSV文件为空\n");
-        fclose(file);
-        *read_time = 0;
+        free_inventory_part_table(parts);
         return -1;
     }
-
-    while (fgets(line, sizeof(line), file)) {
-        line[strcspn(line, "\n")] = '\0';
-
-        if (count >= *capacity) {
-            *capacity *= 2;
-            InventoryPart* temp = (InventoryPart*)realloc(*parts, *capacity * sizeof(InventoryPart));
-            if (!temp) {
-                perror("内存扩容失败");
-                fclose(file);
-                *read_time = 0;
-                return -1;
-            }
-            *parts = temp;
-        }
-
-        InventoryPart* part = &(*parts)[count];
-        char* token;
-        int field_idx = 0;
-
-        token = strtok(line, ",");
-        while (token != NULL && field_idx < 5) {
-            trim(token);
-            switch (field_idx) {
-                case 0:
-                    part->inventory_id = atoi(token);
-                    break;
-                case 1:
-                    strncpy(part->part_num, token, sizeof(part->part_num) - 1);
-                    part->part_num[sizeof(part->part_num) - 1] = '\0';
-                    break;
-                case 2:
-                    part->color_id = atoi(token);
-                    break;
-                case 3:
-                    part->quantity = atoi(token);
-                    break;
-                case 4:
-                    part->is_spare = (strcmp(token, "t") == 0) ? 't' : 'f';
-                    break;
-            }
-            field_idx++;
-            token = strtok(NULL, ",");
-        }
-        count++;
-    }
-
-    fclose(file);
-    *read_time = (double)(clock() - start) / CLOCKS_PER_SEC * 1000;
     return count;
 }
 
-void export_spare_parts(InventoryPart* parts, int count, const char* txt_filename, double* export_time) {
-    clock_t start = clock();
-
-    FILE* file = fopen(txt_filename, "w");
-    if (!file) {
+// 导出空闲零件：过滤只读is_spare一列，命中的行再取其余各列，直接拼进输出缓冲区（OutWriter.h）
+// 返回导出的行数，失败返回-1
+int export_spare_parts(const InventoryPartTable* parts, const char* txt_filename) {
+    OutWriter out;
+    if (out_open(&out, txt_filename, OUT_PLAIN) != 0) {
         perror("无法创建输出TXT文件");
-        *export_time = 0;
-        return;
+        return -1;
     }
 
-    fprintf(file, "inventory_id,part_num,color_id,quantity\n");
+    out_str(&out, "inventory_id,part_num,color_id,quantity\n");
 
     int spare_count = 0;
-    for (int i = 0; i < count; i++) {
-        if (parts[i].is_spare == 't') {
-            fprintf(file, "%d,%s,%d,%d\n",
-                    parts[i].inventory_id,
-                    parts[i].part_num,
-                    parts[i].color_id,
-                    parts[i].quantity);
+    for (int i = 0; i < parts->count; i++) {
+        if (parts->is_spare[i] == 't') {
+            StrView part_num = str_dict_get(parts->part_num[i]);  // 只在输出时取正文
+            out_int(&out, parts->inventory_id[i]);
+            out_char(&out, ',');
+            out_write(&out, part_num.ptr, part_num.len);
+            out_char(&out, ',');
+            out_int(&out, parts->color_id[i]);
+            out_char(&out, ',');
+            out_int(&out, parts->quantity[i]);
+            out_char(&out, '\n');
             spare_count++;
         }
     }
 
-
-
-    fclose(file);
-    *export_time = (double)(clock() - start) / CLOCKS_PER_SEC * 1000;
+    if (out_close(&out) != 0) {
+        perror("写入输出TXT文件失败");
+        return -1;
+    }
+    return spare_count;
 }
 
-int main() {
-    const int TEST_COUNT = 10;  // 测试次数
-    double total_times[TEST_COUNT];  // 存储每次总耗时（读取+导出）
-    double avg_time = 0.0;
+// 用法：RetrievalSingle [--runs N] [--warmup N] [--csv 文件] [--json 文件] [--cache warm|cold|direct|mem] [--perf]
+// 每次测试都重新读取CSV，分 load / output / free 三个阶段计时（见Bench.h）
+int main(int argc, char *argv[]) {
+    Bench bench;
+    bench_init(&bench, "RetrievalSingle", 10, 1);  // 默认预热1次、测试10次
+    bench_input(&bench, INVENTORY_PARTS_PATH);
+    if (bench_parse_args(&bench, &argc, argv) != 0) return 1;
 
-    // 循环执行10次测试（每次都重新读取CSV）
-    for (int i = 0; i < TEST_COUNT; i++) {
+    while (bench_next_run(&bench)) {
         char filename[50];
-        InventoryPart* inventory_parts = NULL;  // 每次测试重新分配内存
-        int part_count, capacity;
-        double read_time, export_time;
+        InventoryPartTable inventory_parts;  // 每次测试重新加载
+        int run = bench.run < 0 ? 0 : bench.run;  // 预热写第一个文件，之后会被覆盖
 
         // 生成文件名：spare_parts10.txt 到 spare_parts19.txt
-        sprintf(filename, "D:\\SQLlab\\lego\\outputs\\spare_parts%d.txt", 10 + i);
+        sprintf(filename, "D:\\SQLlab\\lego\\outputs\\spare_parts%d.txt", 10 + run);
 
-        printf("===== 测试 %d/%d 开始 =====", i + 1, TEST_COUNT);
-        
-        // 1. 重新读取CSV并记录时间（每次测试都执行）
-        printf("开始读取inventory_parts.csv...\n");
-        part_count = read_inventory_from_csv("D:\\SQLlab\\lego\\data\\inventory_parts.csv", &inventory_parts, &capacity, &read_time);
+        if (bench_is_warmup(&bench)) {
+            printf("===== 预热 =====\n");
+        } else {
+            printf("===== 测试 %d/%d 开始 =====\n", run + 1, bench.runs);
+        }
+
+        // 1. 重新读取CSV（每次测试都执行）
+        bench_phase(&bench, "load");
+        int part_count = read_inventory_from_csv(INVENTORY_PARTS_PATH, &inventory_parts);
         if (part_count <= 0) {
-            if (inventory_parts) free(inventory_parts);
+            bench_run_end(&bench, 0);
+            bench_free(&bench);
+            str_dict_release();
             return 1;
         }
-        printf("CSV读取完成：共读取 %d 条记录，耗时 %.2f 毫秒\n", part_count, read_time);
-
-        // 2. 导出TXT并记录时间
-        printf("开始导出空闲零件...\n");
-        export_spare_parts(inventory_parts, part_count, filename, &export_time);
-        printf("导出处理耗时：%.2f 毫秒\n", export_time);
-
-        // 3. 计算本次总耗时（读取+导出）
-        total_times[i] = read_time + export_time;
-        printf("测试 %d 总耗时：%.2f 毫秒\n\n", i + 1, total_times[i]);
-
-        // 释放本次测试的内存（避免累计占用）
-        free(inventory_parts);
-        
-        // 累加用于计算平均值
-        avg_time += total_times[i];
-    }
+        printf("CSV读取完成：共读取 %d 条记录，耗时 %.2f 毫秒\n", part_count, bench_phase_time(&bench, "load") * 1000);
 
-    // 计算并输出平均耗时
-    avg_time /= TEST_COUNT;
-    printf("===== 测试完成 =====");
-    printf("10次测试总耗时分别为：\n");
-    for (int i = 0; i < TEST_COUNT; i++) {
-        printf("测试 %d：%.2f 毫秒\n", i + 1, total_times[i]);
+        // 2. 导出TXT
+        bench_phase(&bench, "output");
+        int spare_count = export_spare_parts(&inventory_parts, filename);
+        printf("导出 %d 条空闲零件，耗时 %.2f 毫秒\n", spare_count, bench_phase_time(&bench, "output") * 1000);
+
+        // 3. 释放本次测试的内存（避免累计占用）
+        bench_phase(&bench, "free");
+        free_inventory_part_table(&inventory_parts);
+
+        double total = bench_run_end(&bench, spare_count >= 0);
+        printf("本次总耗时：%.2f 毫秒\n\n", total * 1000);
     }
-    printf("平均耗时：%.2f 毫秒\n", avg_time);
 
+    bench_report(&bench);
+    bench_free(&bench);
+    str_dict_release();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,189 @@
+#ifndef SORT_PERM_H
+#define SORT_PERM_H
+
+// 排序算子：按整数键对下标数组（排列）排序，不移动行本身，调用方再按排列取行。
+//   SORT_STABLE：LSD基数排序（每轮8位，所有键某一字节相同的轮次跳过），键相同的保持原顺序；
+//   否则：内省排序（快速排序，递归过深改堆排序，小区间插入排序），不保证相同键的顺序；
+//   sort_perm_topk：只要前k个时用大小为k的堆，相同键按下标小的在前，结果与稳定排序的前k个一致。
+// 临时数组从调用方给的arena分配。
+
+#include <stdint.h>
+#include "Arena.h"
+
+#define SORT_ASC 0
+#define SORT_DESC 1     // 降序
+#define SORT_STABLE 2   // 稳定排序
+
+// 把键换成无符号数，使无符号比较的大小顺序就是要求的输出顺序（降序时取反）
+static inline uint32_t sort_key_bits(int key, int flags) {
+    uint32_t u = (uint32_t)key ^ 0x80000000u;
+    return (flags & SORT_DESC) ? ~u : u;
+}
+
+static inline int sort_radix(const int *keys, int *perm, int n, int flags, Arena *arena) {
+    uint32_t *bits = (uint32_t*)arena_alloc(arena, (size_t)n * 2 * sizeof(uint32_t));
+    int *tmp_perm = (int*)arena_alloc(arena, (size_t)n * sizeof(int));
+    if (!bits || !tmp_perm) return -1;
+    uint32_t *tmp_bits = bits + n;
+
+    for (int i = 0; i < n; i++) {
+        perm[i] = i;
+        bits[i] = sort_key_bits(keys[i], flags);
+    }
+    for (int shift = 0; shift < 32; shift += 8) {
+        int count[257] = {0};
+        for (int i = 0; i < n; i++) count[((bits[i] >> shift) & 0xFF) + 1]++;
+        if (count[((bits[0] >> shift) & 0xFF) + 1] == n) continue;  // 这一字节全部相同
+        for (int b = 0; b < 256; b++) count[b + 1] += count[b];
+        for (int i = 0; i < n; i++) {
+            int pos = count[(bits[i] >> shift) & 0xFF]++;
+            tmp_bits[pos] = bits[i];
+            tmp_perm[pos] = perm[i];
+        }
+        memcpy(bits, tmp_bits, (size_t)n * sizeof(uint32_t));
+        memcpy(perm, tmp_perm, (size_t)n * sizeof(int));
+    }
+    return 0;
+}
+
+static inline void sort_swap(int *a, int *b) {
+    int t = *a;
+    *a = *b;
+    *b = t;
+}
+
+static inline void sort_insertion(const uint32_t *bits, int *perm, int lo, int hi) {
+    for (int i = lo + 1; i < hi; i++) {
+        int v = perm[i];
+        int j = i;
+        while (j > lo && bits[perm[j - 1]] > bits[v]) {
+            perm[j] = perm[j - 1];
+            j--;
+        }
+        perm[j] = v;
+    }
+}
+
+// 在perm[lo..hi)上以lo为根、偏移lo的大根堆里下沉
+static inline void sort_sift_down(const uint32_t *bits, int *perm, int lo, int root, int size) {
+    for (;;) {
+        int child = 2 * root + 1;
+        if (child >= size) break;
+        if (child + 1 < size && bits[perm[lo + child + 1]] > bits[perm[lo + child]]) child++;
+        if (bits[perm[lo + root]] >= bits[perm[lo + child]]) break;
+        sort_swap(&perm[lo + root], &perm[lo + child]);
+        root = child;
+    }
+}
+
+static inline void sort_heap(const uint32_t *bits, int *perm, int lo, int hi) {
+    int size = hi - lo;
+    for (int i = size / 2 - 1; i >= 0; i--) sort_sift_down(bits, perm, lo, i, size);
+    for (int end = size - 1; end > 0; end--) {
+        sort_swap(&perm[lo], &perm[lo + end]);
+        sort_sift_down(bits, perm, lo, 0, end);
+    }
+}
+
+static inline void sort_intro(const uint32_t *bits, int *perm, int lo, int hi, int depth) {
+    while (hi - lo > 16) {
+        if (depth-- == 0) {
+            sort_heap(bits, perm, lo, hi);
+            return;
+        }
+        // 三数取中作为枢轴，再做三路划分，大量相同键时不退化
+        int mid = lo + (hi - lo) / 2;
+        if (bits[perm[mid]] < bits[perm[lo]]) sort_swap(&perm[mid], &perm[lo]);
+        if (bits[perm[hi - 1]] < bits[perm[lo]]) sort_swap(&perm[hi - 1], &perm[lo]);
+        if (bits[perm[hi - 1]] < bits[perm[mid]]) sort_swap(&perm[hi - 1], &perm[mid]);
+        uint32_t pivot = bits[perm[mid]];
+        int lt = lo, i = lo, gt = hi;
+        while (i < gt) {
+            if (bits[perm[i]] < pivot) {
+                sort_swap(&perm[lt++], &perm[i++]);
+            } else if (bits[perm[i]] > pivot) {
+                sort_swap(&perm[i], &perm[--gt]);
+            } else {
+                i++;
+            }
+        }
+        // 先递归较小的一侧，较大的一侧继续循环
+        if (lt - lo < hi - gt) {
+            sort_intro(bits, perm, lo, lt, depth);
+            lo = gt;
+        } else {
+            sort_intro(bits, perm, gt, hi, depth);
+            hi = lt;
+        }
+    }
+    sort_insertion(bits, perm, lo, hi);
+}
+
+// 对keys[0..n)排序，结果排列写入perm（perm[i]为排第i的行号）。成功返回0，内存不足返回-1
+static inline int sort_perm(const int *keys, int *perm, int n, int flags, Arena *arena) {
+    if (n <= 0) return 0;
+    if (flags & SORT_STABLE) return sort_radix(keys, perm, n, flags, arena);
+
+    uint32_t *bits = (uint32_t*)arena_alloc(arena, (size_t)n * sizeof(uint32_t));
+    if (!bits) return -1;
+    int depth = 0;
+    for (int i = 0; i < n; i++) {
+        perm[i] = i;
+        bits[i] = sort_key_bits(keys[i], flags);
+    }
+    for (int m = n; m > 1; m >>= 1) depth += 2;
+    sort_intro(bits, perm, 0, n, depth);
+    return 0;
+}
+
+// 堆中的先后：键小的在前，键相同时行号小的在前
+static inline int sort_topk_before(const uint32_t *bits, int a, int b) {
+    return bits[a] < bits[b] || (bits[a] == bits[b] && a < b);
+}
+
+// 堆顶是已选出的k个里最靠后的一个
+static inline void sort_topk_sift(const uint32_t *bits, int *heap, int root, int size) {
+    for (;;) {
+        int child = 2 * root + 1;
+        if (child >= size) break;
+        if (child + 1 < size && sort_topk_before(bits, heap[child], heap[child + 1])) child++;
+        if (!sort_topk_before(bits, heap[root], heap[child])) break;
+        sort_swap(&heap[root], &heap[child]);
+        root = child;
+    }
+}
+
+// 只取排序后的前k个（LIMIT k），写入perm[0..返回值)；结果与稳定排序的前k个相同。
+// 返回实际个数min(n, k)，内存不足返回-1
+static inline int sort_perm_topk(const int *keys, int *perm, int n, int k, int flags, Arena *arena) {
+    if (k > n) k = n;
+    if (k <= 0) return 0;
+
+    uint32_t *bits = (uint32_t*)arena_alloc(arena, (size_t)n * sizeof(uint32_t));
+    if (!bits) return -1;
+    for (int i = 0; i < n; i++) bits[i] = sort_key_bits(keys[i], flags);
+
+    int size = 0;
+    for (int i = 0; i < n; i++) {
+        if (size < k) {
+            // 上浮
+            int pos = size++;
+            perm[pos] = i;
+            while (pos > 0 && sort_topk_before(bits, perm[(pos - 1) / 2], perm[pos])) {
+                sort_swap(&perm[(pos - 1) / 2], &perm[pos]);
+                pos = (pos - 1) / 2;
+            }
+        } else if (sort_topk_before(bits, i, perm[0])) {
+            perm[0] = i;
+            sort_topk_sift(bits, perm, 0, size);
+        }
+    }
+    // 依次把堆顶（最靠后的）换到末尾，得到从前到后的顺序
+    for (int end = size - 1; end > 0; end--) {
+        sort_swap(&perm[0], &perm[end]);
+        sort_topk_sift(bits, perm, 0, end);
+    }
+    return size;
+}
+
+#endif
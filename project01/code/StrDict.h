@@ -0,0 +1,149 @@
+#ifndef STR_DICT_H
+#define STR_DICT_H
+
+// 进程级字符串字典：把零件编号、名称、颜色等字符串驻留为32位编码，相同字符串编码相同。
+// 表里只存编码，等值过滤和关联直接比较整数，只有输出时才用str_dict_get取回正文。
+// 正文和条目页都从字典自己的Arena分配，不依赖CSV或快照的映射，表释放后编码仍然有效。
+// 驻留加锁；条目按页存放、页一经分配不再移动，所以取正文不需要加锁。
+// 编译时需要加 -pthread。
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "CsvMap.h"
+#include "Arena.h"
+
+typedef uint32_t StrCode;
+
+#define STR_CODE_NONE UINT32_MAX               // 字符串不在字典中/内存不足
+#define STR_DICT_PAGE_BITS 12                  // 每页4096个条目
+#define STR_DICT_PAGE_SIZE (1u << STR_DICT_PAGE_BITS)
+#define STR_DICT_MAX_PAGES (1u << 14)          // 最多约6700万个不同字符串
+
+typedef struct {
+    pthread_mutex_t lock;
+    StrView *pages[STR_DICT_MAX_PAGES];  // 编码code的条目在pages[code >> 12][code & 4095]
+    uint32_t count;
+    uint32_t *slots;                     // 开放寻址表，存"编码+1"，0为空
+    uint32_t slot_mask;
+    Arena arena;                         // 正文和条目页
+} StrDict;
+
+static StrDict str_dict_global = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static inline uint32_t str_dict_hash(const char *p, int len) {
+    uint32_t h = 2166136261u;  // FNV-1a
+    for (int i = 0; i < len; i++) {
+        h ^= (unsigned char)p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// 取回编码对应的正文（编码必须来自本字典）
+static inline StrView str_dict_get(StrCode code) {
+    return str_dict_global.pages[code >> STR_DICT_PAGE_BITS][code & (STR_DICT_PAGE_SIZE - 1)];
+}
+
+static inline int str_dict_grow_slots_locked(StrDict *dict) {
+    uint32_t new_mask = dict->slot_mask ? dict->slot_mask * 2 + 1 : 4095;
+    uint32_t *slots = (uint32_t*)calloc((size_t)new_mask + 1, sizeof(uint32_t));
+    if (!slots) return -1;
+    for (uint32_t code = 0; code < dict->count; code++) {
+        StrView sv = str_dict_get(code);
+        uint32_t i = str_dict_hash(sv.ptr, sv.len) & new_mask;
+        while (slots[i]) i = (i + 1) & new_mask;
+        slots[i] = code + 1;
+    }
+    free(dict->slots);
+    dict->slots = slots;
+    dict->slot_mask = new_mask;
+    return 0;
+}
+
+static inline StrCode str_intern_locked(StrDict *dict, StrView sv) {
+    if (dict->count * 2 >= dict->slot_mask && str_dict_grow_slots_locked(dict) != 0) return STR_CODE_NONE;
+
+    uint32_t i = str_dict_hash(sv.ptr, sv.len) & dict->slot_mask;
+    while (dict->slots[i]) {
+        StrCode code = dict->slots[i] - 1;
+        StrView entry = str_dict_get(code);
+        if (entry.len == sv.len && memcmp(entry.ptr, sv.ptr, sv.len) == 0) return code;
+        i = (i + 1) & dict->slot_mask;
+    }
+
+    StrCode code = dict->count;
+    uint32_t page = code >> STR_DICT_PAGE_BITS;
+    if (page >= STR_DICT_MAX_PAGES) return STR_CODE_NONE;
+    if (!dict->pages[page]) {
+        dict->pages[page] = (StrView*)arena_alloc(&dict->arena, STR_DICT_PAGE_SIZE * sizeof(StrView));
+        if (!dict->pages[page]) return STR_CODE_NONE;
+    }
+    const char *text = arena_copy_bytes(&dict->arena, sv.ptr, (size_t)sv.len);
+    if (!text) return STR_CODE_NONE;
+    dict->pages[page][code & (STR_DICT_PAGE_SIZE - 1)] = (StrView){ text, sv.len };
+    dict->count++;
+    dict->slots[i] = code + 1;
+    return code;
+}
+
+// 驻留一个字符串，返回编码；内存不足返回STR_CODE_NONE
+static inline StrCode str_intern(StrView sv) {
+    pthread_mutex_lock(&str_dict_global.lock);
+    StrCode code = str_intern_locked(&str_dict_global, sv);
+    pthread_mutex_unlock(&str_dict_global.lock);
+    return code;
+}
+
+// 批量驻留（整列只加一次锁），成功返回0，内存不足返回-1
+static inline int str_intern_many(const StrView *strs, int count, StrCode *codes) {
+    int ok = 1;
+    pthread_mutex_lock(&str_dict_global.lock);
+    for (int i = 0; i < count && ok; i++) {
+        codes[i] = str_intern_locked(&str_dict_global, strs[i]);
+        if (codes[i] == STR_CODE_NONE) ok = 0;
+    }
+    pthread_mutex_unlock(&str_dict_global.lock);
+    return ok ? 0 : -1;
+}
+
+// 查找已驻留字符串的编码（不插入），不存在返回STR_CODE_NONE。
+// 用于过滤条件：不存在的常量不会等于任何一行的编码
+static inline StrCode str_dict_find(const char *cstr) {
+    StrDict *dict = &str_dict_global;
+    StrCode result = STR_CODE_NONE;
+    int len = (int)strlen(cstr);
+    pthread_mutex_lock(&dict->lock);
+    if (dict->slots) {
+        uint32_t i = str_dict_hash(cstr, len) & dict->slot_mask;
+        while (dict->slots[i]) {
+            StrCode code = dict->slots[i] - 1;
+            StrView entry = str_dict_get(code);
+            if (entry.len == len && memcmp(entry.ptr, cstr, len) == 0) {
+                result = code;
+                break;
+            }
+            i = (i + 1) & dict->slot_mask;
+        }
+    }
+    pthread_mutex_unlock(&dict->lock);
+    return result;
+}
+
+// 释放整个字典：正文、条目页和哈希表。之后此前的所有编码都失效，字典可以重新驻留。
+// 程序结束前在释放各表之后调用，调用时不能有其他线程在用字典
+static inline void str_dict_release(void) {
+    StrDict *dict = &str_dict_global;
+    pthread_mutex_lock(&dict->lock);
+    uint32_t pages = (dict->count + STR_DICT_PAGE_SIZE - 1) >> STR_DICT_PAGE_BITS;
+    memset(dict->pages, 0, pages * sizeof(dict->pages[0]));
+    arena_release(&dict->arena);
+    free(dict->slots);
+    dict->slots = NULL;
+    dict->slot_mask = 0;
+    dict->count = 0;
+    pthread_mutex_unlock(&dict->lock);
+}
+
+#endif
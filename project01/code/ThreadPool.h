@@ -0,0 +1,180 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+// 固定大小的工作线程池：任务放进一个先进先出的队列，由工作线程依次取出执行。
+// 同一批任务用TaskGroup计数，task_group_wait等这一批做完；等待期间等待者也会
+// 帮忙执行队列里的任务，所以在池内任务里再提交子任务并等待也不会死锁。
+// 编译时需要加 -pthread。
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+typedef void (*TaskFn)(void *arg);
+
+typedef struct TaskGroup {
+    int pending;  // 已提交但尚未完成的任务数（由线程池的锁保护）
+} TaskGroup;
+
+typedef struct Task {
+    TaskFn fn;
+    void *arg;
+    TaskGroup *group;
+    struct Task *next;
+} Task;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t has_task;   // 队列非空或要求退出
+    pthread_cond_t task_done;  // 有任务完成
+    Task *head, *tail;
+    pthread_t *threads;
+    int thread_count;
+    int shutdown;
+} ThreadPool;
+
+// 在已持有锁的情况下执行一个任务，执行期间释放锁
+static inline void thread_pool_run_locked(ThreadPool *pool, Task *task) {
+    pthread_mutex_unlock(&pool->lock);
+    task->fn(task->arg);
+    pthread_mutex_lock(&pool->lock);
+    if (task->group) task->group->pending--;
+    free(task);
+    pthread_cond_broadcast(&pool->task_done);
+}
+
+static inline Task* thread_pool_pop_locked(ThreadPool *pool) {
+    Task *task = pool->head;
+    if (task) {
+        pool->head = task->next;
+        if (!pool->head) pool->tail = NULL;
+    }
+    return task;
+}
+
+static void* thread_pool_worker(void *arg) {
+    ThreadPool *pool = (ThreadPool*)arg;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->head && !pool->shutdown) {
+            pthread_cond_wait(&pool->has_task, &pool->lock);
+        }
+        Task *task = thread_pool_pop_locked(pool);
+        if (!task) break;  // 队列已空且要求退出
+        thread_pool_run_locked(pool, task);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// 在线CPU核数（至少为1）
+static inline int thread_pool_cpu_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+// 创建线程池，thread_count<=0时按CPU核数；失败返回NULL
+static inline ThreadPool* thread_pool_create(int thread_count) {
+    if (thread_count <= 0) thread_count = thread_pool_cpu_count();
+    ThreadPool *pool = (ThreadPool*)calloc(1, sizeof(ThreadPool));
+    if (!pool) return NULL;
+    pool->threads = (pthread_t*)malloc(thread_count * sizeof(pthread_t));
+    if (!pool->threads) {
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->has_task, NULL);
+    pthread_cond_init(&pool->task_done, NULL);
+    for (int i = 0; i < thread_count; i++) {
+        if (pthread_create(&pool->threads[i], NULL, thread_pool_worker, pool) != 0) break;
+        pool->thread_count++;
+    }
+    if (pool->thread_count == 0) {
+        perror("线程创建失败");
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+// 提交任务；内存不足时直接在当前线程执行，保证任务一定会被执行
+static inline void thread_pool_submit(ThreadPool *pool, TaskGroup *group, TaskFn fn, void *arg) {
+    Task *task = (Task*)malloc(sizeof(Task));
+    if (!task) {
+        fn(arg);
+        return;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    task->group = group;
+    task->next = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (group) group->pending++;
+    if (pool->tail) {
+        pool->tail->next = task;
+    } else {
+        pool->head = task;
+    }
+    pool->tail = task;
+    pthread_cond_signal(&pool->has_task);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// 等待group中的任务全部完成，等待时顺带执行队列中的任务
+static inline void task_group_wait(ThreadPool *pool, TaskGroup *group) {
+    pthread_mutex_lock(&pool->lock);
+    while (group->pending > 0) {
+        Task *task = thread_pool_pop_locked(pool);
+        if (task) {
+            thread_pool_run_locked(pool, task);
+        } else {
+            pthread_cond_wait(&pool->task_done, &pool->lock);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// 只等待、不帮忙执行：给池外的线程用（如压测的客户端线程），这样同时执行的任务数只由工作线程数决定
+static inline void task_group_wait_idle(ThreadPool *pool, TaskGroup *group) {
+    pthread_mutex_lock(&pool->lock);
+    while (group->pending > 0) {
+        pthread_cond_wait(&pool->task_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// 执行完队列中剩余任务后关闭线程池
+static inline void thread_pool_destroy(ThreadPool *pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->has_task);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->has_task);
+    pthread_cond_destroy(&pool->task_done);
+    free(pool->threads);
+    free(pool);
+}
+
+// 进程级共享线程池（按CPU核数创建，随进程结束）
+static ThreadPool *thread_pool_shared_instance = NULL;
+static pthread_once_t thread_pool_shared_once = PTHREAD_ONCE_INIT;
+
+static void thread_pool_shared_init(void) {
+    thread_pool_shared_instance = thread_pool_create(0);
+}
+
+static inline ThreadPool* thread_pool_shared(void) {
+    pthread_once(&thread_pool_shared_once, thread_pool_shared_init);
+    return thread_pool_shared_instance;
+}
+
+#endif
@@ -1,87 +1,133 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
+#include "UpdatePlan.h"
+#include "OutWriter.h"
+#include "Bench.h"
 
 #define MAX_LINE_LENGTH 1024
 #define DELIMITER ','
 #define NUM_COPIES 5
+#define INPUT_FILE_PATH "D:\\SQLlab\\lego\\data\\parts.csv"
 
-int main() {
-    FILE *input_file, *output_file;
+// 逐行读取输入、改写并写出一个副本。成功返回0
+static int write_copy(const UpdatePlan *plan, const char *output_file_path, Bench *bench) {
+    FILE *input_file;
+    OutWriter output_file;
     char line[MAX_LINE_LENGTH];
     char *token;
     char part_num[MAX_LINE_LENGTH];
     char name[MAX_LINE_LENGTH];
     char part_cat_id[MAX_LINE_LENGTH];
-    clock_t start, end;
-    double duration;
+    char new_line[MAX_LINE_LENGTH];
+    StrView fields[PARTS_COLUMN_COUNT], new_fields[PARTS_COLUMN_COUNT];
+    const StrView *row;
 
-    // 输入文件路径
-    const char *input_file_path = "D:\\SQLlab\\lego\\data\\parts.csv";
-
-    for (int i = 1; i <= NUM_COPIES; ++i) {
-        // 构建输出文件路径
-        char output_file_path[MAX_LINE_LENGTH];
-        sprintf(output_file_path, "D:\\SQLlab\\lego\\data\\parts_copy%d.csv", i);
-
-        // 打开输入文件
-        input_file = fopen(input_file_path, "r");
-        if (input_file == NULL) {
-            perror("无法打开输入文件");
-            return 1;
-        }
+    bench_phase(bench, "load");
+    // 打开输入文件
+    input_file = fopen(INPUT_FILE_PATH, "r");
+    if (input_file == NULL) {
+        perror("无法打开输入文件");
+        return -1;
+    }
 
-        // 打开输出文件
-        output_file = fopen(output_file_path, "w");
-        if (output_file == NULL) {
-            perror("无法打开输出文件");
-            fclose(input_file);
-            return 1;
-        }
+    // 打开输出文件
+    if (out_open(&output_file, output_file_path, OUT_PLAIN) != 0) {
+        perror("无法打开输出文件");
+        fclose(input_file);
+        return -1;
+    }
 
-        start = clock();
+    bench_phase(bench, "output");
+    double start = bench_now();
 
-        // 逐行读取输入文件
-        while (fgets(line, MAX_LINE_LENGTH, input_file)!= NULL) {
-            // 移除换行符
-            line[strcspn(line, "\r\n")] = '\0';
+    // 逐行读取输入文件
+    int line_number = 0;
+    while (fgets(line, MAX_LINE_LENGTH, input_file)!= NULL) {
+        int is_header = (line_number++ == 0);
+        // 移除换行符
+        line[strcspn(line, "\r\n")] = '\0';
 
-            // 解析字段
-            token = strtok(line, ",");
+        // 解析字段
+        token = strtok(line, ",");
+        if (token!= NULL) {
+            strcpy(part_num, token);
+            token = strtok(NULL, ",");
             if (token!= NULL) {
-                strcpy(part_num, token);
+                strcpy(name, token);
                 token = strtok(NULL, ",");
                 if (token!= NULL) {
-                    strcpy(name, token);
-                    token = strtok(NULL, ",");
-                    if (token!= NULL) {
-                        strcpy(part_cat_id, token);
-
-                        // 检查最后一列是否为1
-                        if (strcmp(part_cat_id, "1") == 0) {
-                            // 在第一项加前缀“new_”
-                            char new_part_num[MAX_LINE_LENGTH];
-                            sprintf(new_part_num, "new_%s", part_num);
+                    strcpy(part_cat_id, token);
 
-                            // 将最后一列修改为100
-                            fprintf(output_file, "%s,%s,100\n", new_part_num, name);
-                        } else {
-                            // 不需要修改的行直接写入
-                            fprintf(output_file, "%s,%s,%s\n", part_num, name, part_cat_id);
-                        }
+                    // 按执行计划判断并改写（表头不参与）
+                    fields[0].ptr = part_num;
+                    fields[0].len = (int)strlen(part_num);
+                    fields[1].ptr = name;
+                    fields[1].len = (int)strlen(name);
+                    fields[2].ptr = part_cat_id;
+                    fields[2].len = (int)strlen(part_cat_id);
+                    // 不需要修改的行直接写入原字段
+                    row = fields;
+                    if (!is_header) {
+                        int matched = update_plan_execute(plan, fields, PARTS_COLUMN_COUNT, new_fields,
+                                                          new_line, sizeof(new_line));
+                        if (update_plan_report(matched, line_number)) row = new_fields;
                     }
+                    for (int f = 0; f < PARTS_COLUMN_COUNT; f++) {
+                        if (f > 0) out_char(&output_file, ',');
+                        out_write(&output_file, row[f].ptr, row[f].len);
+                    }
+                    out_char(&output_file, '\n');
                 }
             }
         }
+    }
 
-        end = clock();
-        duration = ((double)(end - start)) / CLOCKS_PER_SEC;
+    // 关闭文件（写出缓冲区的剩余部分也算输出）
+    fclose(input_file);
+    int rc = out_close(&output_file);
+    double duration = bench_now() - start;
+    bench_phase(bench, "free");
+    if (rc != 0) {
+        perror("无法写入输出文件");
+        return -1;
+    }
 
-        // 关闭文件
-        fclose(input_file);
-        fclose(output_file);
+    printf("生成文件 %s 完成，耗时: %.4f 秒\n", output_file_path, duration);
+    return 0;
+}
 
-        printf("生成文件 %s 完成，耗时: %.4f 秒\n", output_file_path, duration);
+// 执行的语句默认是 PARTS_UPDATE_SQL，也可以作为第一个参数传入（语法见UpdatePlan.h）
+// 用法：Update [--runs N] [--warmup N] [--csv 文件] [--json 文件] [--cache warm|cold|direct|mem] [--perf] [语句]
+int main(int argc, char *argv[]) {
+    UpdatePlan plan;
+    Bench bench;
+    char error[256];
+    int result = 0;
+
+    bench_init(&bench, "Update", 1, 0);
+    bench_input(&bench, INPUT_FILE_PATH);
+    if (bench_parse_args(&bench, &argc, argv) != 0) return 1;
+    const char *sql = argc > 1 ? argv[1] : PARTS_UPDATE_SQL;
+    if (update_plan_compile(&plan, sql, PARTS_COLUMNS, PARTS_COLUMN_COUNT, error, sizeof(error)) != 0) {
+        printf("语句错误：%s\n", error);
+        return 1;
+    }
+
+    while (bench_next_run(&bench)) {
+        for (int i = 1; i <= NUM_COPIES && result == 0; ++i) {
+            // 构建输出文件路径
+            char output_file_path[MAX_LINE_LENGTH];
+            sprintf(output_file_path, "D:\\SQLlab\\lego\\data\\parts_copy%d.csv", i);
+            result = write_copy(&plan, output_file_path, &bench);
+        }
+        double total_time = bench_run_end(&bench, result == 0);
+        if (result != 0) break;
+        printf("\n所有文件生成完成 | 总耗时：%.4f 秒 | 平均耗时：%.4f 秒\n",
+               total_time, total_time / NUM_COPIES);
     }
-}
\ No newline at end of file
+    if (bench.runs > 1 || bench.csv_path || bench.json_path || bench.perf_enabled) bench_report(&bench);
+    bench_free(&bench);
+    return result == 0 ? 0 : 1;
+}
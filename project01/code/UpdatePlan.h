@@ -0,0 +1,620 @@
+#ifndef UPDATE_PLAN_H
+#define UPDATE_PLAN_H
+
+// 通用的UPDATE执行器：启动时把语句编译成执行计划，逐行执行时只做比较和拼接，不再解析语句。
+//
+// 支持的语句（关键字不区分大小写，UPDATE <表名> 可省略）：
+//   [UPDATE t] SET 列 = 表达式 [, 列 = 表达式 ...] [WHERE 条件 [AND 条件 ...]]
+//   表达式：整数 | '字符串'（''表示一个单引号）| 列名 | (表达式)
+//           | 表达式 || 表达式（拼接，整数按十进制拼入）| 表达式 + - * 表达式（只用于整数）
+//   条件：列 = != <> < <= > >= 常量（整数列与整数比较，字段不是整数时不满足；字符串列按字节比较）
+// 例：SET part_num = 'new_' || part_num, part_cat_id = 100 WHERE part_cat_id = 1
+//
+// 编译结果：条件是预先解析好列号和常量的比较列表；每个赋值是一段后缀表达式（操作码数组），
+// 执行时用一个小栈求值。列类型由调用方给出的表结构决定。
+// 字段按CSV原样传入：取值时去掉外层引号；被赋值的字段原来带引号时，新值也加上引号，其余字段原样保留。
+// 与NewUpdate一致，字段数与表结构不符或有空字段的行（包括格式不对的行）不参与更新。
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include "CsvMap.h"
+
+#define PLAN_MAX_CONDS 16
+#define PLAN_MAX_ASSIGNS 16
+#define PLAN_MAX_OPS 64
+#define PLAN_MAX_TEXT 1024      // 语句中字符串常量的总长
+
+typedef enum {
+    PLAN_INT = 0,
+    PLAN_STR = 1
+} PlanType;
+
+typedef struct {
+    const char *name;
+    PlanType type;
+} PlanColumn;
+
+typedef enum {
+    PLAN_EQ, PLAN_NE, PLAN_LT, PLAN_LE, PLAN_GT, PLAN_GE
+} PlanCmp;
+
+typedef struct {
+    int column;
+    PlanCmp cmp;
+    int value;          // 整数列的常量
+    StrView text;       // 字符串列的常量
+} PlanCond;
+
+typedef enum {
+    PLAN_OP_COL,        // 压入列值
+    PLAN_OP_INT,        // 压入整数常量
+    PLAN_OP_STR,        // 压入字符串常量
+    PLAN_OP_ADD,
+    PLAN_OP_SUB,
+    PLAN_OP_MUL,
+    PLAN_OP_CONCAT
+} PlanOpCode;
+
+typedef struct {
+    PlanOpCode code;
+    int arg;            // 列号或整数常量
+    StrView text;
+} PlanOp;
+
+typedef struct {
+    int column;
+    int op_start, op_count;
+} PlanAssign;
+
+typedef struct {
+    const PlanColumn *columns;
+    int column_count;
+    PlanCond conds[PLAN_MAX_CONDS];
+    int cond_count;
+    PlanAssign assigns[PLAN_MAX_ASSIGNS];
+    int assign_count;
+    PlanOp ops[PLAN_MAX_OPS];
+    int op_count;
+    char text[PLAN_MAX_TEXT];
+    size_t text_len;
+} UpdatePlan;
+
+// parts表的结构和实验用的默认语句
+static const PlanColumn PARTS_COLUMNS[] = {
+    {"part_num", PLAN_STR}, {"name", PLAN_STR}, {"part_cat_id", PLAN_INT}
+};
+#define PARTS_COLUMN_COUNT 3
+#define PARTS_UPDATE_SQL "UPDATE parts SET part_num = 'new_' || part_num, part_cat_id = 100 WHERE part_cat_id = 1"
+
+// ---- 编译 ----
+
+typedef struct {
+    const char *sql;
+    const char *p;
+    UpdatePlan *plan;
+    char *error;
+    size_t error_size;
+    int failed;
+} PlanParser;
+
+static inline void plan_error(PlanParser *parser, const char *message) {
+    if (parser->failed) return;
+    parser->failed = 1;
+    snprintf(parser->error, parser->error_size, "第%d个字符附近：%s",
+             (int)(parser->p - parser->sql) + 1, message);
+}
+
+static inline void plan_skip_space(PlanParser *parser) {
+    while (isspace((unsigned char)*parser->p)) parser->p++;
+}
+
+// 当前位置是关键字word（整词、不区分大小写）时跳过并返回1
+static inline int plan_accept_word(PlanParser *parser, const char *word) {
+    plan_skip_space(parser);
+    size_t n = strlen(word);
+    for (size_t i = 0; i < n; i++) {
+        if (toupper((unsigned char)parser->p[i]) != word[i]) return 0;
+    }
+    char next = parser->p[n];
+    if (isalnum((unsigned char)next) || next == '_') return 0;
+    parser->p += n;
+    return 1;
+}
+
+static inline int plan_accept(PlanParser *parser, const char *symbol) {
+    plan_skip_space(parser);
+    size_t n = strlen(symbol);
+    if (strncmp(parser->p, symbol, n) != 0) return 0;
+    parser->p += n;
+    return 1;
+}
+
+// 读一个列名，返回列号，失败返回-1
+static inline int plan_column(PlanParser *parser) {
+    plan_skip_space(parser);
+    const char *start = parser->p;
+    while (isalnum((unsigned char)*parser->p) || *parser->p == '_') parser->p++;
+    size_t n = (size_t)(parser->p - start);
+    for (int c = 0; n > 0 && c < parser->plan->column_count; c++) {
+        const char *name = parser->plan->columns[c].name;
+        if (strlen(name) == n && strncmp(name, start, n) == 0) return c;
+    }
+    parser->p = start;
+    plan_error(parser, n > 0 ? "未知的列名" : "期望列名");
+    return -1;
+}
+
+static inline int plan_integer(PlanParser *parser, int *value) {
+    plan_skip_space(parser);
+    const char *p = parser->p;
+    int neg = 0;
+    if (*p == '-' || *p == '+') neg = (*p++ == '-');
+    if (!isdigit((unsigned char)*p)) return 0;
+    long v = 0;
+    while (isdigit((unsigned char)*p)) {
+        v = v * 10 + (*p++ - '0');
+        if (v > 2147483647L) {
+            plan_error(parser, "整数超出范围");
+            return 0;
+        }
+    }
+    *value = (int)(neg ? -v : v);
+    parser->p = p;
+    return 1;
+}
+
+// 读一个'...'字符串常量，正文存入计划的常量区
+static inline int plan_string(PlanParser *parser, StrView *text) {
+    plan_skip_space(parser);
+    if (*parser->p != '\'') return 0;
+    UpdatePlan *plan = parser->plan;
+    const char *p = parser->p + 1;
+    size_t start = plan->text_len;
+    for (;;) {
+        if (*p == '\0') {
+            plan_error(parser, "字符串没有结束的引号");
+            return 0;
+        }
+        if (*p == '\'') {
+            if (p[1] != '\'') break;
+            p++;
+        }
+        if (plan->text_len >= PLAN_MAX_TEXT) {
+            plan_error(parser, "字符串常量过长");
+            return 0;
+        }
+        plan->text[plan->text_len++] = *p++;
+    }
+    parser->p = p + 1;
+    text->ptr = plan->text + start;
+    text->len = (int)(plan->text_len - start);
+    return 1;
+}
+
+static inline void plan_emit(PlanParser *parser, PlanOpCode code, int arg, StrView text) {
+    UpdatePlan *plan = parser->plan;
+    if (plan->op_count >= PLAN_MAX_OPS) {
+        plan_error(parser, "表达式过长");
+        return;
+    }
+    plan->ops[plan->op_count].code = code;
+    plan->ops[plan->op_count].arg = arg;
+    plan->ops[plan->op_count].text = text;
+    plan->op_count++;
+}
+
+static inline int plan_parse_concat(PlanParser *parser);
+
+// 各层返回表达式的类型，出错返回-1
+static inline int plan_parse_atom(PlanParser *parser) {
+    StrView text = {NULL, 0};
+    int value;
+    if (plan_accept(parser, "(")) {
+        int type = plan_parse_concat(parser);
+        if (type >= 0 && !plan_accept(parser, ")")) plan_error(parser, "缺少右括号");
+        return parser->failed ? -1 : type;
+    }
+    if (plan_string(parser, &text)) {
+        plan_emit(parser, PLAN_OP_STR, 0, text);
+        return parser->failed ? -1 : PLAN_STR;
+    }
+    if (parser->failed) return -1;
+    if (plan_integer(parser, &value)) {
+        plan_emit(parser, PLAN_OP_INT, value, text);
+        return parser->failed ? -1 : PLAN_INT;
+    }
+    if (parser->failed) return -1;
+    int column = plan_column(parser);
+    if (column < 0) return -1;
+    plan_emit(parser, PLAN_OP_COL, column, text);
+    return parser->failed ? -1 : (int)parser->plan->columns[column].type;
+}
+
+static inline int plan_parse_product(PlanParser *parser) {
+    int type = plan_parse_atom(parser);
+    while (type >= 0 && plan_accept(parser, "*")) {
+        int right = plan_parse_atom(parser);
+        if (right < 0) return -1;
+        if (type != PLAN_INT || right != PLAN_INT) {
+            plan_error(parser, "乘法只能用于整数");
+            return -1;
+        }
+        plan_emit(parser, PLAN_OP_MUL, 0, (StrView){NULL, 0});
+    }
+    return parser->failed ? -1 : type;
+}
+
+static inline int plan_parse_sum(PlanParser *parser) {
+    int type = plan_parse_product(parser);
+    for (;;) {
+        if (type < 0) return -1;
+        PlanOpCode code;
+        plan_skip_space(parser);
+        if (parser->p[0] == '+') {
+            code = PLAN_OP_ADD;
+        } else if (parser->p[0] == '-') {
+            code = PLAN_OP_SUB;
+        } else {
+            return type;
+        }
+        parser->p++;
+        int right = plan_parse_product(parser);
+        if (right < 0) return -1;
+        if (type != PLAN_INT || right != PLAN_INT) {
+            plan_error(parser, "加减只能用于整数");
+            return -1;
+        }
+        plan_emit(parser, code, 0, (StrView){NULL, 0});
+    }
+}
+
+static inline int plan_parse_concat(PlanParser *parser) {
+    int type = plan_parse_sum(parser);
+    while (type >= 0 && plan_accept(parser, "||")) {
+        if (plan_parse_sum(parser) < 0) return -1;
+        plan_emit(parser, PLAN_OP_CONCAT, 0, (StrView){NULL, 0});
+        type = PLAN_STR;
+    }
+    return parser->failed ? -1 : type;
+}
+
+static inline void plan_parse_assign(PlanParser *parser) {
+    UpdatePlan *plan = parser->plan;
+    int column = plan_column(parser);
+    if (column < 0) return;
+    if (!plan_accept(parser, "=")) {
+        plan_error(parser, "期望=");
+        return;
+    }
+    if (plan->assign_count >= PLAN_MAX_ASSIGNS) {
+        plan_error(parser, "赋值过多");
+        return;
+    }
+    PlanAssign *assign = &plan->assigns[plan->assign_count];
+    assign->column = column;
+    assign->op_start = plan->op_count;
+    int type = plan_parse_concat(parser);
+    if (type < 0) return;
+    if (plan->columns[column].type == PLAN_INT && type != PLAN_INT) {
+        plan_error(parser, "整数列只能赋整数表达式");
+        return;
+    }
+    assign->op_count = plan->op_count - assign->op_start;
+    plan->assign_count++;
+}
+
+static inline void plan_parse_cond(PlanParser *parser) {
+    UpdatePlan *plan = parser->plan;
+    int column = plan_column(parser);
+    if (column < 0) return;
+    if (plan->cond_count >= PLAN_MAX_CONDS) {
+        plan_error(parser, "条件过多");
+        return;
+    }
+    PlanCond *cond = &plan->conds[plan->cond_count];
+    // 长的运算符先匹配
+    if (plan_accept(parser, "!=") || plan_accept(parser, "<>")) {
+        cond->cmp = PLAN_NE;
+    } else if (plan_accept(parser, "<=")) {
+        cond->cmp = PLAN_LE;
+    } else if (plan_accept(parser, ">=")) {
+        cond->cmp = PLAN_GE;
+    } else if (plan_accept(parser, "=")) {
+        cond->cmp = PLAN_EQ;
+    } else if (plan_accept(parser, "<")) {
+        cond->cmp = PLAN_LT;
+    } else if (plan_accept(parser, ">")) {
+        cond->cmp = PLAN_GT;
+    } else {
+        plan_error(parser, "期望比较运算符");
+        return;
+    }
+    cond->column = column;
+    cond->value = 0;
+    cond->text.ptr = NULL;
+    cond->text.len = 0;
+    int ok = plan->columns[column].type == PLAN_INT ? plan_integer(parser, &cond->value)
+                                                    : plan_string(parser, &cond->text);
+    if (!ok) {
+        plan_error(parser, plan->columns[column].type == PLAN_INT ? "整数列只能与整数比较"
+                                                                  : "字符串列只能与字符串比较");
+        return;
+    }
+    plan->cond_count++;
+}
+
+// 编译语句，成功返回0；失败返回-1，error里是出错位置和原因
+static inline int update_plan_compile(UpdatePlan *plan, const char *sql, const PlanColumn *columns,
+                                      int column_count, char *error, size_t error_size) {
+    PlanParser parser = {sql, sql, plan, error, error_size, 0};
+    memset(plan, 0, sizeof(*plan));
+    plan->columns = columns;
+    plan->column_count = column_count;
+    if (error_size > 0) error[0] = '\0';
+
+    if (plan_accept_word(&parser, "UPDATE")) {
+        // UPDATE后必须有表名，SET不能当表名，否则"UPDATE SET a = 1"会把SET吞掉
+        plan_skip_space(&parser);
+        const char *name = parser.p;
+        if (plan_accept_word(&parser, "SET")) {
+            parser.p = name;
+            plan_error(&parser, "期望表名");
+        }
+        while (isalnum((unsigned char)*parser.p) || *parser.p == '_') parser.p++;
+        if (!parser.failed && parser.p == name) plan_error(&parser, "期望表名");
+    }
+    if (!plan_accept_word(&parser, "SET")) plan_error(&parser, "期望SET");
+    while (!parser.failed) {
+        plan_parse_assign(&parser);
+        if (!plan_accept(&parser, ",")) break;
+    }
+    if (!parser.failed && plan_accept_word(&parser, "WHERE")) {
+        do {
+            plan_parse_cond(&parser);
+        } while (!parser.failed && plan_accept_word(&parser, "AND"));
+    }
+    plan_accept(&parser, ";");
+    plan_skip_space(&parser);
+    if (!parser.failed && *parser.p != '\0') plan_error(&parser, "语句结尾有多余内容");
+    return parser.failed ? -1 : 0;
+}
+
+// ---- 执行 ----
+
+typedef struct {
+    PlanType type;
+    int value;
+    StrView text;
+} PlanValue;
+
+// 整数转十进制，返回长度（dst至少12字节）
+static inline int plan_itoa(int value, char *dst) {
+    char tmp[12];
+    unsigned int u = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u > 0);
+    int len = 0;
+    if (value < 0) dst[len++] = '-';
+    while (n > 0) dst[len++] = tmp[--n];
+    return len;
+}
+
+// 整数列的值：整个字段（去掉引号后）必须是可带符号的十进制整数，否则返回0
+static inline int plan_field_int(StrView field, int *value) {
+    const char *p = field.ptr, *end = field.ptr + field.len;
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+')) neg = (*p++ == '-');
+    if (p == end) return 0;
+    long long v = 0;
+    for (; p < end; p++) {
+        if (*p < '0' || *p > '9') return 0;
+        v = v * 10 + (*p - '0');
+        if (v > 2147483648LL) return 0;
+    }
+    v = neg ? -v : v;
+    if (v > 2147483647LL) return 0;
+    *value = (int)v;
+    return 1;
+}
+
+// 行是否满足WHERE条件（没有WHERE时所有格式正确的行都满足）
+static inline int update_plan_match(const UpdatePlan *plan, const StrView *fields, int field_count) {
+    if (field_count != plan->column_count) return 0;
+    for (int i = 0; i < field_count; i++) {
+        if (fields[i].len == 0) return 0;
+    }
+    for (int i = 0; i < plan->cond_count; i++) {
+        const PlanCond *cond = &plan->conds[i];
+        StrView field = sv_unquote(fields[cond->column]);
+        int order;
+        if (plan->columns[cond->column].type == PLAN_INT) {
+            int v;
+            if (!plan_field_int(field, &v)) return 0;  // 不是整数的值不满足任何比较
+            order = (v > cond->value) - (v < cond->value);
+        } else {
+            int n = field.len < cond->text.len ? field.len : cond->text.len;
+            order = memcmp(field.ptr, cond->text.ptr, n);
+            if (order == 0) order = (field.len > cond->text.len) - (field.len < cond->text.len);
+        }
+        int ok;
+        switch (cond->cmp) {
+            case PLAN_EQ: ok = order == 0; break;
+            case PLAN_NE: ok = order != 0; break;
+            case PLAN_LT: ok = order < 0; break;
+            case PLAN_LE: ok = order <= 0; break;
+            case PLAN_GT: ok = order > 0; break;
+            default:      ok = order >= 0; break;
+        }
+        if (!ok) return 0;
+    }
+    return 1;
+}
+
+// 整数运算按64位计算，结果超出int范围返回-1
+static inline int plan_arith(PlanOpCode code, int left, int right, int *result) {
+    long long v;
+    switch (code) {
+        case PLAN_OP_ADD: v = (long long)left + right; break;
+        case PLAN_OP_SUB: v = (long long)left - right; break;
+        default:          v = (long long)left * right; break;
+    }
+    if (v < INT_MIN || v > INT_MAX) return -1;
+    *result = (int)v;
+    return 0;
+}
+
+// 字符串列的值：去掉外层引号，引号字段里的""还原成"（还原后的文本写到buf里）
+static inline int plan_field_text(StrView field, StrView *text, char **buf, char *end) {
+    int quoted = field.len >= 2 && field.ptr[0] == '"' && field.ptr[field.len - 1] == '"';
+    *text = sv_unquote(field);
+    if (!quoted || memchr(text->ptr, '"', text->len) == NULL) return 0;
+    if (end - *buf < text->len) return -1;
+    char *dst = *buf;
+    int n = 0;
+    for (int i = 0; i < text->len; i++) {
+        dst[n++] = text->ptr[i];
+        if (text->ptr[i] == '"' && i + 1 < text->len && text->ptr[i + 1] == '"') i++;
+    }
+    text->ptr = dst;
+    text->len = n;
+    *buf += n;
+    return 0;
+}
+
+// 字符串写成CSV字段需要加引号：含逗号、引号、换行
+static inline int plan_needs_quote(StrView text) {
+    for (int i = 0; i < text.len; i++) {
+        char c = text.ptr[i];
+        if (c == ',' || c == '"' || c == '\r' || c == '\n') return 1;
+    }
+    return 0;
+}
+
+// 把值转成文本（整数写到buf里）
+static inline int plan_value_text(PlanValue *value, char **buf, char *end) {
+    if (value->type == PLAN_STR) return 0;
+    if (end - *buf < 12) return -1;
+    value->text.ptr = *buf;
+    value->text.len = plan_itoa(value->value, *buf);
+    *buf += value->text.len;
+    value->type = PLAN_STR;
+    return 0;
+}
+
+#define PLAN_NO_SPACE (-1)    // buf不够
+#define PLAN_OVERFLOW (-2)    // 整数运算溢出
+
+// 计算满足条件的行的新内容：out[i]为新的第i个字段，未赋值的字段与原字段相同，
+// 新的文本写在buf中。buf不够返回PLAN_NO_SPACE，整数运算溢出返回PLAN_OVERFLOW
+static inline int update_plan_apply(const UpdatePlan *plan, const StrView *fields, StrView *out,
+                                    char *buf, size_t size) {
+    PlanValue stack[PLAN_MAX_OPS];
+    char *pos = buf, *end = buf + size;
+    for (int i = 0; i < plan->column_count; i++) out[i] = fields[i];
+
+    for (int a = 0; a < plan->assign_count; a++) {
+        const PlanAssign *assign = &plan->assigns[a];
+        int top = 0;
+        for (int k = 0; k < assign->op_count; k++) {
+            const PlanOp *op = &plan->ops[assign->op_start + k];
+            PlanValue *left = top >= 2 ? &stack[top - 2] : NULL;
+            PlanValue *right = top >= 1 ? &stack[top - 1] : NULL;
+            switch (op->code) {
+                case PLAN_OP_COL: {
+                    stack[top].type = plan->columns[op->arg].type;
+                    if (stack[top].type == PLAN_INT) {
+                        StrView field = sv_unquote(fields[op->arg]);
+                        stack[top].text = field;
+                        if (!plan_field_int(field, &stack[top].value)) stack[top].value = sv_to_int(field);
+                    } else if (plan_field_text(fields[op->arg], &stack[top].text, &pos, end) != 0) {
+                        return PLAN_NO_SPACE;
+                    }
+                    top++;
+                    break;
+                }
+                case PLAN_OP_INT:
+                    stack[top].type = PLAN_INT;
+                    stack[top++].value = op->arg;
+                    break;
+                case PLAN_OP_STR:
+                    stack[top].type = PLAN_STR;
+                    stack[top++].text = op->text;
+                    break;
+                case PLAN_OP_ADD:
+                case PLAN_OP_SUB:
+                case PLAN_OP_MUL:
+                    if (plan_arith(op->code, left->value, right->value, &left->value) != 0) return PLAN_OVERFLOW;
+                    top--;
+                    break;
+                case PLAN_OP_CONCAT: {
+                    if (plan_value_text(left, &pos, end) != 0 || plan_value_text(right, &pos, end) != 0) {
+                        return PLAN_NO_SPACE;
+                    }
+                    if (end - pos < left->text.len + right->text.len) return PLAN_NO_SPACE;
+                    char *dst = pos;
+                    memcpy(pos, left->text.ptr, left->text.len);
+                    pos += left->text.len;
+                    memcpy(pos, right->text.ptr, right->text.len);
+                    pos += right->text.len;
+                    left->text.ptr = dst;
+                    left->text.len = (int)(pos - dst);
+                    top--;
+                    break;
+                }
+            }
+        }
+
+        // 结果写成字段：原字段带引号或新值含逗号、引号、换行时加引号，值里的"写成""
+        PlanValue *result = &stack[0];
+        const StrView *text = &result->text;
+        int quoted = (fields[assign->column].len > 0 && fields[assign->column].ptr[0] == '"') ||
+                     (result->type == PLAN_STR && plan_needs_quote(*text));
+        int quotes = 0;
+        if (result->type == PLAN_STR && quoted) {
+            for (int i = 0; i < text->len; i++) quotes += text->ptr[i] == '"';
+        }
+        if (end - pos < 14 + (result->type == PLAN_STR ? text->len + quotes : 0)) return PLAN_NO_SPACE;
+        char *dst = pos;
+        if (quoted) *pos++ = '"';
+        if (result->type == PLAN_INT) {
+            pos += plan_itoa(result->value, pos);
+        } else if (quotes == 0) {
+            memmove(pos, text->ptr, text->len);
+            pos += text->len;
+        } else {
+            // 文本都在pos之前，逐字节向后写不会覆盖还没读的部分
+            for (int i = 0; i < text->len; i++) {
+                if (text->ptr[i] == '"') *pos++ = '"';
+                *pos++ = text->ptr[i];
+            }
+        }
+        if (quoted) *pos++ = '"';
+        out[assign->column].ptr = dst;
+        out[assign->column].len = (int)(pos - dst);
+    }
+    return 0;
+}
+
+// 匹配并改写一行：返回1=满足条件且已写好out，0=不满足，
+// PLAN_NO_SPACE=buf不够，PLAN_OVERFLOW=整数溢出（这两种情况该行应保持原样）
+static inline int update_plan_execute(const UpdatePlan *plan, const StrView *fields, int field_count,
+                                      StrView *out, char *buf, size_t size) {
+    if (!update_plan_match(plan, fields, field_count)) return 0;
+    int status = update_plan_apply(plan, fields, out, buf, size);
+    return status == 0 ? 1 : status;
+}
+
+// 第line行执行失败时（update_plan_execute返回负数）打印原因，各程序统一用它报告保持原样的行。
+// 返回1表示该行已改写好，0表示该行不改（不匹配或失败）
+static inline int update_plan_report(int status, int line) {
+    if (status == PLAN_NO_SPACE) printf("第 %d 行更新后过长，保持原样\n", line);
+    if (status == PLAN_OVERFLOW) printf("第 %d 行整数运算溢出，保持原样\n", line);
+    return status > 0;
+}
+
+#endif
@@ -0,0 +1,353 @@
+#ifndef WAL_H
+#define WAL_H
+
+// 预写日志（WAL）：更新先以逻辑记录追加到日志，提交时追加一条提交记录并保证日志落盘，数据页之后再写回。
+// 提交记录提交它之前的所有记录，所以并发的事务要么各自只有一条记录，要么由调用方保证追加不交错。
+//
+// 记录格式：WalRecordHeader | payload，lsn是记录在日志文件中的起始偏移，crc覆盖header其余字段和payload。
+// 日志内容对调用方是不透明的（type + payload），重放时交回给调用方的apply函数，
+// 因此记录应当是幂等的（例如整行新内容），同一条记录重放多次结果不变。
+//
+// 崩溃后打开日志：遇到不完整或校验不过的记录（写了一半的尾部）就停止并截掉；
+// 最后一条提交记录之前的记录按顺序重做（redo），之后未提交的记录按逆序撤销（undo）。
+// 缓冲池换出脏页前会让日志落盘，未提交的修改可能已经写进数据页，所以记录里要带修改前的内容供撤销，
+// 而没写进日志的修改一定还没写进数据页，不需要撤销。撤销过的记录仍留在日志里（再次崩溃时重新撤销），
+// 调用方把数据页落盘后用wal_checkpoint清空日志，在此之前不能追加新记录。
+//
+// 提交的三种方式：
+//   WAL_SYNC_EACH：每次提交单独fdatasync一次；
+//   WAL_SYNC_GROUP：组提交，同时等待提交的线程里一个作为领头者写出并fdatasync，其他的等它一起完成，
+//                   有其他提交在等时领头者先等WAL_GROUP_DELAY_US让更多提交加入；
+//   WAL_SYNC_NONE：只写到操作系统，不fdatasync（进程崩溃不丢，掉电可能丢）。
+// 编译时需要加 -pthread。
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define WAL_MAGIC 0x4C41574Cu          // "LWAL"
+#define WAL_BUFFER_SIZE (1 << 20)      // 日志缓冲区，写满时先写出（不同步）
+#define WAL_GROUP_DELAY_US 100         // 组提交时领头者等其他提交加入的时间
+#define WAL_COMMIT 0xFFFFFFFFu         // 提交记录的type（没有payload），调用方的记录不能使用
+
+typedef enum {
+    WAL_SYNC_NONE = 0,
+    WAL_SYNC_EACH = 1,
+    WAL_SYNC_GROUP = 2
+} WalSyncMode;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t len;      // payload长度
+    uint32_t crc;
+    uint32_t type;
+    uint64_t lsn;      // 记录起始偏移，用来识别截断前留下的旧内容
+} WalRecordHeader;
+
+// 重放回调：undo为0时重做这条记录，为1时撤销它（恢复修改前的内容）。成功返回0，返回-1时打开日志失败
+typedef int (*WalApplyFn)(void *ctx, uint32_t type, const char *payload, size_t len, int undo);
+
+typedef struct {
+    int fd;
+    WalSyncMode mode;
+    pthread_mutex_t lock;
+    pthread_cond_t done;      // 一次写出结束时广播
+    char *buffer;             // 已追加、尚未写出的记录
+    char *spare;              // 写出时与buffer交换，写出期间仍可继续追加
+    size_t buffer_len;
+    uint64_t next_lsn;        // 已追加的末尾
+    uint64_t written_lsn;     // 已写到文件的末尾
+    uint64_t durable_lsn;     // 已落盘的末尾
+    int flushing;             // 有线程正在写出
+    int committers;           // 正在等待提交的线程数
+    int failed;               // 写出或同步失败过，之后的提交都返回失败
+    int undo_pending;         // 打开时撤销过未提交的记录，检查点之前不能追加
+    long recovered;           // 打开时重做的已提交记录数
+    long rolled_back;         // 打开时撤销的未提交记录数
+    uint64_t sync_count;      // fdatasync次数
+    uint64_t commit_count;
+} Wal;
+
+// CRC-32（IEEE），按4位查表
+static inline uint32_t wal_crc32(uint32_t crc, const void *data, size_t len) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    const uint8_t *p = (const uint8_t*)data;
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ p[i]) & 0x0F] ^ (crc >> 4);
+        crc = table[(crc ^ (p[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+static inline uint32_t wal_record_crc(const WalRecordHeader *header, const char *payload) {
+    uint32_t crc = wal_crc32(0, &header->len, sizeof(header->len));
+    crc = wal_crc32(crc, &header->type, sizeof(header->type));
+    crc = wal_crc32(crc, &header->lsn, sizeof(header->lsn));
+    return wal_crc32(crc, payload, header->len);
+}
+
+// 重放文件中完整有效的记录：最后一条提交记录之前的按顺序重做，之后的按逆序撤销。
+// 返回有效部分的长度，apply失败或内存不足返回-1
+static inline long long wal_replay(int fd, WalApplyFn apply, void *ctx, long *redone, long *undone) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return -1;
+    size_t size = (size_t)st.st_size;
+    char *data = (char*)malloc(size > 0 ? size : 1);
+    size_t *starts = (size_t*)malloc((size / sizeof(WalRecordHeader) + 1) * sizeof(size_t));
+    if (!data || !starts) {
+        free(data);
+        free(starts);
+        return -1;
+    }
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = pread(fd, data + got, size - got, (off_t)got);
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+
+    // 先找出有效记录和最后一条提交记录
+    size_t pos = 0;
+    long count = 0, committed = 0;
+    while (pos + sizeof(WalRecordHeader) <= got) {
+        WalRecordHeader header;
+        memcpy(&header, data + pos, sizeof(header));
+        const char *payload = data + pos + sizeof(header);
+        if (header.magic != WAL_MAGIC || header.lsn != pos || header.len > got - pos - sizeof(header) ||
+            header.crc != wal_record_crc(&header, payload)) {
+            break;
+        }
+        starts[count++] = pos;
+        if (header.type == WAL_COMMIT) committed = count;
+        pos += sizeof(header) + header.len;
+    }
+
+    int failed = 0;
+    *redone = *undone = 0;
+    for (long i = 0; i < count && !failed; i++) {
+        WalRecordHeader header;
+        long k = i < committed ? i : count - 1 - (i - committed);  // 已提交的正序，未提交的逆序
+        memcpy(&header, data + starts[k], sizeof(header));
+        if (header.type == WAL_COMMIT) continue;
+        if (apply && apply(ctx, header.type, data + starts[k] + sizeof(header), header.len, k >= committed) != 0) {
+            failed = 1;
+        } else if (k < committed) {
+            (*redone)++;
+        } else {
+            (*undone)++;
+        }
+    }
+    free(data);
+    free(starts);
+    return failed ? -1 : (long long)pos;
+}
+
+// 打开（或创建）日志：先重放已有的记录（重做已提交的、撤销未提交的），截掉无效的尾部，之后的记录接在后面。
+// rolled_back大于0时要先让数据页落盘并wal_checkpoint才能追加。成功返回0
+static inline int wal_open(Wal *wal, const char *path, WalSyncMode mode, WalApplyFn apply, void *ctx) {
+    memset(wal, 0, sizeof(*wal));
+    wal->mode = mode;
+    wal->fd = open(path, O_RDWR | O_CREAT, 0644);
+    wal->buffer = (char*)malloc(WAL_BUFFER_SIZE);
+    wal->spare = (char*)malloc(WAL_BUFFER_SIZE);
+    if (wal->fd < 0 || !wal->buffer || !wal->spare) goto fail;
+
+    long long valid = wal_replay(wal->fd, apply, ctx, &wal->recovered, &wal->rolled_back);
+    if (valid < 0 || ftruncate(wal->fd, (off_t)valid) != 0) goto fail;
+    wal->next_lsn = wal->written_lsn = wal->durable_lsn = (uint64_t)valid;
+    wal->undo_pending = wal->rolled_back > 0;
+    pthread_mutex_init(&wal->lock, NULL);
+    pthread_cond_init(&wal->done, NULL);
+    return 0;
+
+fail:
+    {
+        int saved = errno;
+        if (wal->fd >= 0) close(wal->fd);
+        free(wal->buffer);
+        free(wal->spare);
+        memset(wal, 0, sizeof(*wal));
+        errno = saved;
+    }
+    return -1;
+}
+
+// 把缓冲区写到文件（sync=1时再fdatasync）。调用时持有锁且没有其他线程在写出，写出期间释放锁
+static inline int wal_write_out_locked(Wal *wal, int sync) {
+    char *data = wal->buffer;
+    size_t len = wal->buffer_len;
+    uint64_t offset = wal->written_lsn;
+    uint64_t end = wal->next_lsn;
+    wal->buffer = wal->spare;
+    wal->spare = data;
+    wal->buffer_len = 0;
+    wal->flushing = 1;
+    pthread_mutex_unlock(&wal->lock);
+
+    int result = 0;
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pwrite(wal->fd, data + done, len - done, (off_t)(offset + done));
+        if (n <= 0) {
+            result = -1;
+            break;
+        }
+        done += (size_t)n;
+    }
+    if (result == 0 && sync && fdatasync(wal->fd) != 0) result = -1;
+
+    pthread_mutex_lock(&wal->lock);
+    wal->flushing = 0;
+    if (result == 0) {
+        wal->written_lsn = end;
+        if (sync) {
+            wal->durable_lsn = end;
+            wal->sync_count++;
+        }
+    } else {
+        wal->failed = 1;
+    }
+    pthread_cond_broadcast(&wal->done);
+    return result;
+}
+
+// 追加一条记录（调用时持有锁），返回记录的结束位置，失败返回0
+static inline uint64_t wal_append_locked(Wal *wal, uint32_t type, const void *payload, size_t len) {
+    WalRecordHeader header;
+    size_t total = sizeof(header) + len;
+    if (total > WAL_BUFFER_SIZE) {
+        errno = EFBIG;
+        return 0;
+    }
+    while (!wal->failed && wal->buffer_len + total > WAL_BUFFER_SIZE) {
+        if (wal->flushing) {
+            pthread_cond_wait(&wal->done, &wal->lock);
+        } else {
+            wal_write_out_locked(wal, 0);
+        }
+    }
+    if (wal->failed || wal->undo_pending) {
+        errno = wal->failed ? EIO : EBUSY;
+        return 0;
+    }
+    header.magic = WAL_MAGIC;
+    header.len = (uint32_t)len;
+    header.type = type;
+    header.lsn = wal->next_lsn;
+    header.crc = wal_record_crc(&header, (const char*)payload);
+    memcpy(wal->buffer + wal->buffer_len, &header, sizeof(header));
+    if (len > 0) memcpy(wal->buffer + wal->buffer_len + sizeof(header), payload, len);
+    wal->buffer_len += total;
+    wal->next_lsn += total;
+    return wal->next_lsn;
+}
+
+// 追加一条记录，返回记录的结束位置，失败返回0。记录在提交之前也可能被写出（缓冲区满或换出脏页时），
+// 但没有提交记录的部分在恢复时会被撤销
+static inline uint64_t wal_append(Wal *wal, uint32_t type, const void *payload, size_t len) {
+    pthread_mutex_lock(&wal->lock);
+    uint64_t end = wal_append_locked(wal, type, payload, len);
+    pthread_mutex_unlock(&wal->lock);
+    return end;
+}
+
+// 提交：追加一条提交记录，按同步方式保证它和之前的记录已写出/落盘。成功返回0
+static inline int wal_commit(Wal *wal) {
+    int result = 0;
+    pthread_mutex_lock(&wal->lock);
+    uint64_t lsn = wal_append_locked(wal, WAL_COMMIT, NULL, 0);
+    if (lsn == 0) {
+        pthread_mutex_unlock(&wal->lock);
+        return -1;
+    }
+    wal->committers++;
+    if (wal->mode == WAL_SYNC_EACH) {
+        // 每次提交都单独同步一次，不与其他提交合并
+        while (wal->flushing && !wal->failed) pthread_cond_wait(&wal->done, &wal->lock);
+        if (!wal->failed) wal_write_out_locked(wal, 1);
+    } else {
+        int sync = wal->mode == WAL_SYNC_GROUP;
+        for (;;) {
+            uint64_t reached = sync ? wal->durable_lsn : wal->written_lsn;
+            if (wal->failed || reached >= lsn) break;
+            if (wal->flushing) {
+                pthread_cond_wait(&wal->done, &wal->lock);
+                continue;
+            }
+            if (sync && wal->committers > 1) {
+                // 还有别的提交在等：领头者稍等，让更多记录赶上这一次同步
+                wal->flushing = 1;
+                pthread_mutex_unlock(&wal->lock);
+                usleep(WAL_GROUP_DELAY_US);
+                pthread_mutex_lock(&wal->lock);
+                wal->flushing = 0;
+            }
+            wal_write_out_locked(wal, sync);
+        }
+    }
+    if (wal->failed) {
+        errno = EIO;
+        result = -1;
+    } else {
+        wal->commit_count++;
+    }
+    wal->committers--;
+    pthread_mutex_unlock(&wal->lock);
+    return result;
+}
+
+// 把已追加的全部记录写出，除WAL_SYNC_NONE外再落盘；已经落盘的部分不再同步。成功返回0
+static inline int wal_flush(Wal *wal) {
+    pthread_mutex_lock(&wal->lock);
+    int sync = wal->mode != WAL_SYNC_NONE;
+    uint64_t lsn = wal->next_lsn;
+    while (!wal->failed && (sync ? wal->durable_lsn : wal->written_lsn) < lsn) {
+        if (wal->flushing) {
+            pthread_cond_wait(&wal->done, &wal->lock);
+        } else {
+            wal_write_out_locked(wal, sync);
+        }
+    }
+    int result = wal->failed ? -1 : 0;
+    pthread_mutex_unlock(&wal->lock);
+    if (result != 0) errno = EIO;
+    return result;
+}
+
+// 检查点：调用方已把日志覆盖的修改（包括打开时的重做和撤销）全部落盘后调用，清空日志。
+// 调用期间不能有其他线程追加
+static inline int wal_checkpoint(Wal *wal) {
+    if (wal_flush(wal) != 0) return -1;
+    pthread_mutex_lock(&wal->lock);
+    int result = ftruncate(wal->fd, 0) == 0 && fdatasync(wal->fd) == 0 ? 0 : -1;
+    if (result == 0) {
+        wal->next_lsn = wal->written_lsn = wal->durable_lsn = 0;
+        wal->undo_pending = 0;
+    }
+    pthread_mutex_unlock(&wal->lock);
+    return result;
+}
+
+// 写出剩余记录后关闭，失败返回-1（资源照样释放）
+static inline int wal_close(Wal *wal) {
+    int result = wal_flush(wal);
+    close(wal->fd);
+    free(wal->buffer);
+    free(wal->spare);
+    pthread_mutex_destroy(&wal->lock);
+    pthread_cond_destroy(&wal->done);
+    memset(wal, 0, sizeof(*wal));
+    return result;
+}
+
+#endif